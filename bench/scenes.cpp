@@ -0,0 +1,479 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#include "pipeline_desc.hpp"
+#include "uniform.hpp"
+#include "uniform_desc.hpp"
+#include "vertex_quantizer.hpp"
+#include "vulkan_minimal.hpp"
+
+// Renders synthetic scenes of N meshes, M textures and K pipelines offscreen and reports startup time, frame times,
+// upload throughput and memory use as JSON. The scenes only depend on their parameters and seed, the vertex format
+// is either the full precision Vertex or QuantizedVertex.
+
+using Clock = std::chrono::steady_clock;
+
+struct Config
+{
+    uint32_t meshCount = 256;
+    uint32_t textureCount = 16;
+    uint32_t pipelineCount = 4;
+    uint32_t frameCount = 500;
+    // quads per side of each mesh
+    uint32_t gridSize = 16;
+    uint32_t textureSize = 256;
+    uint32_t seed = 1;
+    bool bQuantizedVertices = false;
+    VkExtent2D extent = {1280, 720};
+    // stdout if empty
+    std::string outputFilename;
+};
+
+struct Mesh
+{
+    std::pair<VkBuffer, RHI::Memory::Allocation> vertexBuffer;
+    std::pair<VkBuffer, RHI::Memory::Allocation> indexBuffer;
+    uint32_t indexCount;
+    uint32_t textureIndex;
+    uint32_t pipelineIndex;
+};
+
+struct Texture
+{
+    std::pair<VkImage, RHI::Memory::Allocation> image;
+    VkImageView view;
+    VkDescriptorSet descriptorSet;
+};
+
+static double elapsed_ms(Clock::time_point begin, Clock::time_point end = Clock::now())
+{
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+static double get_percentile(const std::vector<double> &sorted, double percentile)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t index = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[(std::min)(index, sorted.size() - 1)];
+}
+
+/**
+ * @brief grid of quads at a random depth and position in clip space
+ *
+ */
+static void generate_mesh(std::mt19937 &random, uint32_t gridSize, std::vector<Vertex> &vertices,
+                          std::vector<uint16_t> &indices)
+{
+    std::uniform_real_distribution<float> position(-1.f, 0.6f);
+    std::uniform_real_distribution<float> depth(0.1f, 0.9f);
+    std::uniform_real_distribution<float> channel(0.f, 1.f);
+    glm::vec2 origin = {position(random), position(random)};
+    float z = depth(random);
+    glm::vec4 color = {channel(random), channel(random), channel(random), 1.f};
+    float cellSize = 0.4f / gridSize;
+
+    vertices.clear();
+    indices.clear();
+    for (uint32_t y = 0; y <= gridSize; ++y)
+    {
+        for (uint32_t x = 0; x <= gridSize; ++x)
+        {
+            vertices.emplace_back(Vertex{
+                .position = {origin.x + x * cellSize, origin.y + y * cellSize, z},
+                .color = color,
+                .uv = {static_cast<float>(x) / gridSize, static_cast<float>(y) / gridSize},
+            });
+        }
+    }
+    for (uint32_t y = 0; y < gridSize; ++y)
+    {
+        for (uint32_t x = 0; x < gridSize; ++x)
+        {
+            uint16_t i = static_cast<uint16_t>(y * (gridSize + 1) + x);
+            uint16_t row = static_cast<uint16_t>(gridSize + 1);
+            indices.insert(indices.end(), {i, static_cast<uint16_t>(i + 1), static_cast<uint16_t>(i + row + 1),
+                                           static_cast<uint16_t>(i + row + 1), static_cast<uint16_t>(i + row), i});
+        }
+    }
+}
+
+/**
+ * @brief checkerboard of two random colors
+ *
+ */
+static std::vector<uint8_t> generate_texture(std::mt19937 &random, uint32_t size)
+{
+    std::uniform_int_distribution<uint32_t> channel(0, 255);
+    uint8_t colors[2][4];
+    for (auto &color : colors)
+    {
+        for (uint8_t &c : color)
+            c = static_cast<uint8_t>(channel(random));
+        color[3] = 255;
+    }
+
+    std::vector<uint8_t> pixels(size * size * 4);
+    for (uint32_t y = 0; y < size; ++y)
+    {
+        for (uint32_t x = 0; x < size; ++x)
+            memcpy(&pixels[(y * size + x) * 4], colors[((x / 16) + (y / 16)) % 2], 4);
+    }
+    return pixels;
+}
+
+static Config parse_arguments(int argc, char **argv)
+{
+    Config config;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "--meshes")
+            config.meshCount = static_cast<uint32_t>(std::stoul(value));
+        else if (arg == "--textures")
+            config.textureCount = (std::max)(static_cast<uint32_t>(std::stoul(value)), 1u);
+        else if (arg == "--pipelines")
+            config.pipelineCount = (std::max)(static_cast<uint32_t>(std::stoul(value)), 1u);
+        else if (arg == "--frames")
+            config.frameCount = (std::max)(static_cast<uint32_t>(std::stoul(value)), 1u);
+        else if (arg == "--grid")
+            config.gridSize = std::clamp(static_cast<uint32_t>(std::stoul(value)), 1u, 255u);
+        else if (arg == "--seed")
+            config.seed = static_cast<uint32_t>(std::stoul(value));
+        else if (arg == "--vertex-format")
+            config.bQuantizedVertices = value == "quantized";
+        else if (arg == "--output")
+            config.outputFilename = value;
+        else
+            std::cerr << "Unknown argument : " << arg << std::endl;
+    }
+    return config;
+}
+
+int main(int argc, char **argv)
+{
+    Clock::time_point startupBegin = Clock::now();
+    Config config = parse_arguments(argc, argv);
+    std::mt19937 random(config.seed);
+    const uint32_t frameInFlightCount = 2;
+
+    RHI::load_symbols();
+    VkInstance instance = RHI::Instance::create_instance({}, {}, false);
+    VkPhysicalDevice physicalDevice = RHI::Device::get_physical_devices(instance)[0];
+    uint32_t graphicsFamilyIndex =
+        RHI::Device::Queue::find_queue_family_index(physicalDevice, VK_QUEUE_GRAPHICS_BIT).value();
+    VkDevice device = RHI::Device::create_logical_device(instance, physicalDevice, nullptr, {}, {});
+    VkQueue queue = RHI::Device::Queue::get_device_queue(device, graphicsFamilyIndex, 0);
+    RHI::Memory::Allocator allocator = RHI::Memory::create_allocator(device, physicalDevice);
+    RHI::Memory::Staging::Ring stagingRing = RHI::Memory::Staging::create_staging_ring(
+        device, allocator, queue, graphicsFamilyIndex, queue, graphicsFamilyIndex);
+    double deviceTime = elapsed_ms(startupBegin);
+
+    // offscreen targets
+    VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    VkFormat depthFormat = VK_FORMAT_D32_SFLOAT_S8_UINT;
+    std::vector<std::pair<VkImage, RHI::Memory::Allocation>> colorImages;
+    std::vector<VkImageView> colorViews;
+    for (uint32_t i = 0; i < frameInFlightCount; ++i)
+    {
+        colorImages.emplace_back(RHI::Memory::Image::create_allocated_image(
+            device, allocator, config.extent.width, config.extent.height, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            colorFormat));
+        colorViews.emplace_back(RHI::Memory::Image::create_image_view(device, colorImages.back().first, colorFormat,
+                                                                      VK_IMAGE_ASPECT_COLOR_BIT));
+    }
+    auto depthImage =
+        RHI::Memory::Image::create_allocated_image(device, allocator, config.extent.width, config.extent.height,
+                                                   VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthFormat);
+    VkImageView depthView =
+        RHI::Memory::Image::create_image_view(device, depthImage.first, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+    VkRenderPass renderPass = RHI::RenderPass::create_render_pass(device, colorFormat, depthFormat,
+                                                                  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    std::vector<VkFramebuffer> framebuffers =
+        RHI::RenderPass::create_framebuffers(device, renderPass, colorViews, depthView, config.extent);
+
+    // meshes, generated and converted to their vertex layout before timing the uploads through the staging ring
+    std::vector<std::vector<char>> meshVertexData(config.meshCount);
+    std::vector<std::vector<uint16_t>> meshIndices(config.meshCount);
+    float maxPositionError = 0.f;
+    std::vector<Vertex> vertices;
+    for (uint32_t i = 0; i < config.meshCount; ++i)
+    {
+        generate_mesh(random, config.gridSize, vertices, meshIndices[i]);
+        const char *vertexData = reinterpret_cast<const char *>(vertices.data());
+        size_t vertexBufferSize = sizeof(Vertex) * vertices.size();
+        std::vector<QuantizedVertex> quantizedVertices;
+        if (config.bQuantizedVertices)
+        {
+            maxPositionError =
+                (std::max)(maxPositionError, VertexQuantizer::get_max_position_error<QuantizedVertex>(vertices));
+            quantizedVertices = VertexQuantizer::quantize_vertices<QuantizedVertex>(vertices);
+            vertexData = reinterpret_cast<const char *>(quantizedVertices.data());
+            vertexBufferSize = sizeof(QuantizedVertex) * quantizedVertices.size();
+        }
+        meshVertexData[i].assign(vertexData, vertexData + vertexBufferSize);
+    }
+
+    Clock::time_point uploadBegin = Clock::now();
+    VkDeviceSize uploadedBytes = 0;
+    std::vector<Mesh> meshes(config.meshCount);
+    VkDeviceSize vertexBytes = 0;
+    for (uint32_t i = 0; i < config.meshCount; ++i)
+    {
+        size_t vertexBufferSize = meshVertexData[i].size();
+        size_t indexBufferSize = sizeof(uint16_t) * meshIndices[i].size();
+        meshes[i] = Mesh{
+            .vertexBuffer = RHI::Memory::Buffer::create_optimal_buffer_from_data(
+                device, allocator, stagingRing, vertexBufferSize, meshVertexData[i].data(),
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT),
+            .indexBuffer = RHI::Memory::Buffer::create_optimal_buffer_from_data(
+                device, allocator, stagingRing, indexBufferSize, meshIndices[i].data(),
+                VK_BUFFER_USAGE_INDEX_BUFFER_BIT),
+            .indexCount = static_cast<uint32_t>(meshIndices[i].size()),
+            .textureIndex = i % config.textureCount,
+            .pipelineIndex = i % config.pipelineCount,
+        };
+        uploadedBytes += vertexBufferSize + indexBufferSize;
+        vertexBytes += vertexBufferSize;
+    }
+    RHI::Memory::Staging::wait_idle(stagingRing);
+    double uploadTime = elapsed_ms(uploadBegin);
+
+    // the uniform buffer is shared by every draw, the vertices are already in clip space
+    auto uniformBuffer = RHI::Memory::Buffer::create_allocated_buffer(
+        device, allocator, sizeof(UniformBufferObjectT), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    UniformBufferObjectT ubo = {.view = glm::mat4(1.f), .proj = glm::mat4(1.f)};
+    DrawConstantsT drawConstants = {.model = glm::mat4(1.f)};
+    RHI::Memory::copy_data_to_memory(allocator, uniformBuffer.second, &ubo, sizeof(ubo));
+
+    // textures, one descriptor set each
+    std::vector<VkDescriptorSetLayout> setLayouts = {RHI::Pipeline::Shader::create_descriptor_set_layout(
+        device, UniformDesc::get_uniform_descriptor_set_layout_bindings())};
+    VkPipelineLayout pipelineLayout = RHI::Pipeline::Shader::create_pipeline_layout(
+        device, setLayouts, UniformDesc::get_draw_push_constant_ranges());
+    VkDescriptorPool descriptorPool = RHI::Pipeline::Shader::create_descriptor_pool(
+        device, UniformDesc::get_uniform_descriptor_pool_sizes(config.textureCount), config.textureCount);
+    std::vector<VkDescriptorSet> descriptorSets = RHI::Pipeline::Shader::allocate_desriptor_sets(
+        device, descriptorPool, config.textureCount,
+        std::vector<VkDescriptorSetLayout>(config.textureCount, setLayouts[0]));
+    VkSampler sampler = RHI::Memory::Image::create_image_sampler(device, VK_FILTER_LINEAR);
+    std::vector<Texture> textures(config.textureCount);
+    for (uint32_t i = 0; i < config.textureCount; ++i)
+    {
+        std::vector<uint8_t> pixels = generate_texture(random, config.textureSize);
+        textures[i].image = RHI::Memory::Image::create_image_texture_from_data(
+            device, allocator, stagingRing, config.textureSize, config.textureSize, pixels.data());
+        textures[i].view = RHI::Memory::Image::create_image_view(device, textures[i].image.first,
+                                                                 VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+        textures[i].descriptorSet = descriptorSets[i];
+
+        VkDescriptorBufferInfo bufferInfo = {
+            .buffer = uniformBuffer.first,
+            .offset = 0,
+            .range = sizeof(UniformBufferObjectT),
+        };
+        VkDescriptorImageInfo imageInfo = {
+            .sampler = sampler,
+            .imageView = textures[i].view,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        };
+        RHI::Pipeline::Shader::write_descriptor_sets(
+            device, UniformDesc::get_uniform_descriptor_set_writes(textures[i].descriptorSet, bufferInfo, imageInfo));
+    }
+    RHI::Memory::Staging::wait_idle(stagingRing);
+
+    // pipelines, created without a pipeline cache to measure cold startups
+    Clock::time_point pipelineBegin = Clock::now();
+    RHI::Pipeline::Registry registry = RHI::Pipeline::create_registry(device);
+    std::vector<VkPipeline> pipelines;
+    for (uint32_t i = 0; i < config.pipelineCount; ++i)
+    {
+        RHI::Pipeline::PipelineDesc desc =
+            RHI::Pipeline::get_default_pipeline_desc(renderPass, "triangle", pipelineLayout);
+        desc.cullMode = VK_CULL_MODE_NONE;
+        if (config.bQuantizedVertices)
+            RHI::Pipeline::set_vertex_layout<QuantizedVertex>(desc);
+        // a constant the shaders do not declare is ignored, every value still makes a distinct pipeline
+        RHI::Pipeline::set_specialization_constant(desc, VK_SHADER_STAGE_VERTEX_BIT, 1000, i);
+        pipelines.emplace_back(RHI::Pipeline::get_pipeline(registry, desc));
+    }
+    double pipelineTime = elapsed_ms(pipelineBegin);
+
+    // fewest state changes : by pipeline, then by texture
+    std::vector<uint32_t> drawOrder(meshes.size());
+    for (uint32_t i = 0; i < drawOrder.size(); ++i)
+        drawOrder[i] = i;
+    std::sort(drawOrder.begin(), drawOrder.end(), [&meshes](uint32_t a, uint32_t b) {
+        return std::tie(meshes[a].pipelineIndex, meshes[a].textureIndex) <
+               std::tie(meshes[b].pipelineIndex, meshes[b].textureIndex);
+    });
+
+    VkCommandPool commandPool = RHI::Command::create_command_pool(device, graphicsFamilyIndex);
+    std::vector<VkCommandBuffer> commandBuffers =
+        RHI::Command::allocate_command_buffers(device, commandPool, frameInFlightCount);
+    std::vector<VkFence> fences;
+    for (uint32_t i = 0; i < frameInFlightCount; ++i)
+        fences.emplace_back(RHI::Parallel::create_fence(device));
+
+    double startupTime = 0.0;
+    std::vector<double> frameTimes;
+    frameTimes.reserve(config.frameCount);
+    Clock::time_point renderBegin = Clock::now();
+    for (uint32_t frameIndex = 0; frameIndex < config.frameCount; ++frameIndex)
+    {
+        Clock::time_point frameBegin = Clock::now();
+        uint32_t imageIndex = RHI::Render::acquire_offscreen_back_buffer(device, frameIndex, frameInFlightCount,
+                                                                         fences[frameIndex % frameInFlightCount]);
+        VkCommandBuffer commandBuffer = commandBuffers[imageIndex];
+
+        RHI::Render::record_back_buffer_begin_render_pass(commandBuffer, renderPass, framebuffers[imageIndex],
+                                                          config.extent, pipelines[0]);
+        uint32_t boundPipeline = 0;
+        uint32_t boundTexture = ~0u;
+        for (uint32_t meshIndex : drawOrder)
+        {
+            const Mesh &mesh = meshes[meshIndex];
+            if (mesh.pipelineIndex != boundPipeline)
+            {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[mesh.pipelineIndex]);
+                boundPipeline = mesh.pipelineIndex;
+            }
+            if (mesh.textureIndex != boundTexture)
+            {
+                RHI::Render::record_back_buffer_descriptor_sets_commands(
+                    commandBuffer, pipelineLayout, textures[mesh.textureIndex].descriptorSet);
+                boundTexture = mesh.textureIndex;
+            }
+            RHI::Render::record_back_buffer_draw_indexed_object_commands(
+                commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                drawConstants, mesh.vertexBuffer.first, mesh.indexBuffer.first, mesh.indexCount);
+        }
+        RHI::Render::record_back_buffer_end_render_pass(commandBuffer);
+        RHI::Render::submit_offscreen_back_buffer(queue, commandBuffer, fences[imageIndex]);
+
+        if (frameIndex == 0)
+        {
+            // startup ends once the first frame is rendered
+            vkWaitForFences(device, 1, &fences[imageIndex], VK_TRUE, UINT64_MAX);
+            startupTime = elapsed_ms(startupBegin);
+            renderBegin = Clock::now();
+            continue;
+        }
+        frameTimes.emplace_back(elapsed_ms(frameBegin));
+    }
+    vkDeviceWaitIdle(device);
+    double renderTime = elapsed_ms(renderBegin);
+
+    RHI::Memory::Statistics memoryStats = RHI::Memory::get_statistics(allocator);
+    long peakResidentKB = 0;
+#ifdef __linux__
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        peakResidentKB = usage.ru_maxrss;
+#endif
+
+    std::vector<double> sortedFrameTimes = frameTimes;
+    std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+    double averageFrameTime = sortedFrameTimes.empty() ? 0.0 : renderTime / sortedFrameTimes.size();
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"device\": \"" << properties.deviceName << "\",\n"
+         << "  \"scene\": {\"meshes\": " << config.meshCount << ", \"textures\": " << config.textureCount
+         << ", \"pipelines\": " << config.pipelineCount << ", \"grid\": " << config.gridSize
+         << ", \"seed\": " << config.seed << ", \"width\": " << config.extent.width
+         << ", \"height\": " << config.extent.height
+         << ", \"vertex_format\": \"" << (config.bQuantizedVertices ? "quantized" : "full") << "\"},\n"
+         << "  \"startup_ms\": {\"total\": " << startupTime << ", \"device\": " << deviceTime
+         << ", \"upload\": " << uploadTime << ", \"pipelines\": " << pipelineTime << "},\n"
+         << "  \"frame_ms\": {\"count\": " << sortedFrameTimes.size() << ", \"avg\": " << averageFrameTime
+         << ", \"min\": " << get_percentile(sortedFrameTimes, 0.0)
+         << ", \"p50\": " << get_percentile(sortedFrameTimes, 50.0)
+         << ", \"p90\": " << get_percentile(sortedFrameTimes, 90.0)
+         << ", \"p99\": " << get_percentile(sortedFrameTimes, 99.0)
+         << ", \"max\": " << get_percentile(sortedFrameTimes, 100.0) << "},\n"
+         << "  \"upload\": {\"bytes\": " << uploadedBytes
+         << ", \"mb_per_s\": " << (uploadTime > 0.0 ? uploadedBytes / (1024.0 * 1024.0) / (uploadTime / 1000.0) : 0.0)
+         << "},\n"
+         << "  \"vertices\": {\"bytes\": " << vertexBytes
+         << ", \"stride\": " << (config.bQuantizedVertices ? sizeof(QuantizedVertex) : sizeof(Vertex))
+         << ", \"max_position_error\": " << maxPositionError << "},\n"
+         << "  \"memory\": {\"device_reserved_bytes\": " << memoryStats.reservedBytes
+         << ", \"device_used_bytes\": " << memoryStats.usedBytes << ", \"blocks\": " << memoryStats.blockCount
+         << ", \"allocations\": " << memoryStats.allocationCount << ", \"peak_resident_kb\": " << peakResidentKB
+         << "}\n"
+         << "}\n";
+    if (config.outputFilename.empty())
+    {
+        std::cout << json.str();
+    }
+    else
+    {
+        std::ofstream file(config.outputFilename);
+        if (!file.is_open())
+            std::cerr << "Failed to open file : " << config.outputFilename << std::endl;
+        file << json.str();
+    }
+
+    for (VkFence fence : fences)
+        RHI::Parallel::destroy_fence(device, fence);
+    RHI::Command::destroy_command_pool(device, commandPool);
+    RHI::Pipeline::destroy_registry(registry);
+
+    for (Texture &texture : textures)
+    {
+        RHI::Memory::Image::destroy_image_view(device, texture.view);
+        RHI::Memory::free_memory(allocator, texture.image.second);
+        RHI::Memory::Image::destroy_image(device, texture.image.first);
+    }
+    RHI::Memory::Image::destroy_image_sampler(device, sampler);
+    RHI::Pipeline::Shader::destroy_descriptor_pool(device, descriptorPool);
+    RHI::Pipeline::Shader::destroy_pipeline_layout(device, pipelineLayout);
+    RHI::Pipeline::Shader::destroy_descriptor_set_layout(device, setLayouts[0]);
+    RHI::Memory::free_memory(allocator, uniformBuffer.second);
+    RHI::Memory::Buffer::destroy_buffer(device, uniformBuffer.first);
+
+    for (Mesh &mesh : meshes)
+    {
+        RHI::Memory::free_memory(allocator, mesh.indexBuffer.second);
+        RHI::Memory::Buffer::destroy_buffer(device, mesh.indexBuffer.first);
+        RHI::Memory::free_memory(allocator, mesh.vertexBuffer.second);
+        RHI::Memory::Buffer::destroy_buffer(device, mesh.vertexBuffer.first);
+    }
+
+    RHI::RenderPass::destroy_framebuffers(device, framebuffers);
+    RHI::RenderPass::destroy_render_pass(device, renderPass);
+    RHI::Memory::Image::destroy_image_view(device, depthView);
+    RHI::Memory::free_memory(allocator, depthImage.second);
+    RHI::Memory::Image::destroy_image(device, depthImage.first);
+    for (uint32_t i = 0; i < frameInFlightCount; ++i)
+    {
+        RHI::Memory::Image::destroy_image_view(device, colorViews[i]);
+        RHI::Memory::free_memory(allocator, colorImages[i].second);
+        RHI::Memory::Image::destroy_image(device, colorImages[i].first);
+    }
+
+    RHI::Memory::Staging::destroy_staging_ring(stagingRing);
+    RHI::Memory::destroy_allocator(allocator);
+    RHI::Device::destroy_logical_device(device);
+    RHI::Instance::destroy_instance(instance);
+
+    return EXIT_SUCCESS;
+}
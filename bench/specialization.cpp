@@ -0,0 +1,188 @@
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include "pipeline_desc.hpp"
+#include "vulkan_minimal.hpp"
+
+// Compares a shader branching on uniform feature toggles with pipelines specialized per feature permutation.
+// Renders offscreen, no window required.
+
+constexpr uint32_t featureCount = 4;
+
+struct FeatureToggles
+{
+    uint32_t mask;
+};
+
+static double render_frames(VkDevice device, VkQueue queue, VkCommandBuffer commandBuffer, VkFence fence,
+                            VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent, VkPipeline pipeline,
+                            VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet, uint32_t frameCount,
+                            uint32_t overdraw)
+{
+    std::chrono::duration<double, std::milli> total(0.0);
+    for (uint32_t frame = 0; frame < frameCount; ++frame)
+    {
+        RHI::Render::record_back_buffer_begin_render_pass(commandBuffer, renderPass, framebuffer, extent, pipeline);
+        RHI::Render::record_back_buffer_descriptor_sets_commands(commandBuffer, pipelineLayout, descriptorSet);
+        // full screen triangles, fragment bound
+        for (uint32_t i = 0; i < overdraw; ++i)
+            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        RHI::Render::record_back_buffer_end_render_pass(commandBuffer);
+
+        VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &commandBuffer,
+        };
+        auto start = std::chrono::high_resolution_clock::now();
+        vkResetFences(device, 1, &fence);
+        vkQueueSubmit(queue, 1, &submitInfo, fence);
+        vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+        total += std::chrono::high_resolution_clock::now() - start;
+    }
+    return total.count() / frameCount;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frameCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 100;
+    uint32_t overdraw = 8;
+    VkExtent2D extent = {1920, 1080};
+
+    RHI::load_symbols();
+    VkInstance instance = RHI::Instance::create_instance({}, {}, false);
+    VkPhysicalDevice physicalDevice = RHI::Device::get_physical_devices(instance)[0];
+    uint32_t graphicsFamilyIndex =
+        RHI::Device::Queue::find_queue_family_index(physicalDevice, VK_QUEUE_GRAPHICS_BIT).value();
+    VkDevice device = RHI::Device::create_logical_device(instance, physicalDevice, nullptr, {}, {});
+    VkQueue queue = RHI::Device::Queue::get_device_queue(device, graphicsFamilyIndex, 0);
+    RHI::Memory::Allocator allocator = RHI::Memory::create_allocator(device, physicalDevice);
+
+    // offscreen targets
+    VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    VkFormat depthFormat = VK_FORMAT_D32_SFLOAT_S8_UINT;
+    auto colorImage = RHI::Memory::Image::create_allocated_image(
+        device, allocator, extent.width, extent.height, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, colorFormat);
+    auto depthImage = RHI::Memory::Image::create_allocated_image(
+        device, allocator, extent.width, extent.height, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthFormat);
+    VkImageView colorView =
+        RHI::Memory::Image::create_image_view(device, colorImage.first, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+    VkImageView depthView =
+        RHI::Memory::Image::create_image_view(device, depthImage.first, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+    VkRenderPass renderPass = RHI::RenderPass::create_render_pass(device, colorFormat, depthFormat,
+                                                                  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    VkFramebuffer framebuffer =
+        RHI::RenderPass::create_framebuffers(device, renderPass, {colorView}, depthView, extent)[0];
+
+    // feature toggles read by the uniform branching pipeline
+    std::vector<VkDescriptorSetLayoutBinding> bindings = {{
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+    }};
+    VkDescriptorSetLayout setLayout = RHI::Pipeline::Shader::create_descriptor_set_layout(device, bindings);
+    VkPipelineLayout pipelineLayout = RHI::Pipeline::Shader::create_pipeline_layout(device, {setLayout});
+    VkDescriptorPool descriptorPool = RHI::Pipeline::Shader::create_descriptor_pool(
+        device, {{.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1}}, 1);
+    VkDescriptorSet descriptorSet =
+        RHI::Pipeline::Shader::allocate_desriptor_sets(device, descriptorPool, 1, {setLayout})[0];
+    auto togglesBuffer = RHI::Memory::Buffer::create_allocated_buffer(
+        device, allocator, sizeof(FeatureToggles), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    VkDescriptorBufferInfo bufferInfo = {
+        .buffer = togglesBuffer.first,
+        .offset = 0,
+        .range = sizeof(FeatureToggles),
+    };
+    RHI::Pipeline::Shader::write_descriptor_sets(device, {{
+                                                             .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                                             .dstSet = descriptorSet,
+                                                             .dstBinding = 0,
+                                                             .descriptorCount = 1,
+                                                             .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                             .pBufferInfo = &bufferInfo,
+                                                         }});
+
+    RHI::Pipeline::PipelineDesc baseDesc = {
+        .shaderStages =
+            {
+                {.stage = VK_SHADER_STAGE_VERTEX_BIT, .path = "shaders/fullscreen.vert.spv"},
+                {.stage = VK_SHADER_STAGE_FRAGMENT_BIT, .path = "shaders/features.frag.spv"},
+            },
+        .cullMode = VK_CULL_MODE_NONE,
+        .depthTestEnable = VK_FALSE,
+        .depthWriteEnable = VK_FALSE,
+        .colorBlendAttachments = {{
+            .blendEnable = VK_FALSE,
+            .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+                              VK_COLOR_COMPONENT_A_BIT,
+        }},
+        .pipelineLayout = pipelineLayout,
+        .renderPass = renderPass,
+    };
+
+    RHI::Pipeline::Registry registry = RHI::Pipeline::create_registry(device);
+    VkPipeline uniformPipeline = RHI::Pipeline::get_pipeline(registry, baseDesc);
+
+    VkCommandPool commandPool = RHI::Command::create_command_pool(device, graphicsFamilyIndex);
+    VkCommandBuffer commandBuffer = RHI::Command::allocate_command_buffers(device, commandPool, 1)[0];
+    VkFence fence = RHI::Parallel::create_fence(device);
+
+    std::cout << "mask\tuniform (ms)\tspecialized (ms)" << std::endl;
+    for (uint32_t mask = 0; mask < (1u << featureCount); ++mask)
+    {
+        FeatureToggles toggles = {.mask = mask};
+        RHI::Memory::copy_data_to_memory(allocator, togglesBuffer.second, &toggles, sizeof(toggles));
+
+        RHI::Pipeline::PipelineDesc specializedDesc = baseDesc;
+        RHI::Pipeline::set_specialization_constant(specializedDesc, VK_SHADER_STAGE_FRAGMENT_BIT, 0, true);
+        for (uint32_t feature = 0; feature < featureCount; ++feature)
+        {
+            RHI::Pipeline::set_specialization_constant(specializedDesc, VK_SHADER_STAGE_FRAGMENT_BIT, feature + 1,
+                                                       (mask & (1u << feature)) != 0);
+        }
+        VkPipeline specializedPipeline = RHI::Pipeline::get_pipeline(registry, specializedDesc);
+
+        // warm up both pipelines before measuring
+        render_frames(device, queue, commandBuffer, fence, renderPass, framebuffer, extent, uniformPipeline,
+                      pipelineLayout, descriptorSet, 5, overdraw);
+        double uniformTime = render_frames(device, queue, commandBuffer, fence, renderPass, framebuffer, extent,
+                                           uniformPipeline, pipelineLayout, descriptorSet, frameCount, overdraw);
+        render_frames(device, queue, commandBuffer, fence, renderPass, framebuffer, extent, specializedPipeline,
+                      pipelineLayout, descriptorSet, 5, overdraw);
+        double specializedTime = render_frames(device, queue, commandBuffer, fence, renderPass, framebuffer, extent,
+                                               specializedPipeline, pipelineLayout, descriptorSet, frameCount,
+                                               overdraw);
+
+        std::cout << mask << "\t" << uniformTime << "\t" << specializedTime << std::endl;
+    }
+
+    vkDeviceWaitIdle(device);
+
+    RHI::Parallel::destroy_fence(device, fence);
+    RHI::Command::destroy_command_pool(device, commandPool);
+    RHI::Pipeline::destroy_registry(registry);
+
+    RHI::Memory::free_memory(allocator, togglesBuffer.second);
+    RHI::Memory::Buffer::destroy_buffer(device, togglesBuffer.first);
+    RHI::Pipeline::Shader::destroy_descriptor_pool(device, descriptorPool);
+    RHI::Pipeline::Shader::destroy_pipeline_layout(device, pipelineLayout);
+    RHI::Pipeline::Shader::destroy_descriptor_set_layout(device, setLayout);
+
+    RHI::RenderPass::destroy_framebuffers(device, {framebuffer});
+    RHI::RenderPass::destroy_render_pass(device, renderPass);
+    RHI::Memory::Image::destroy_image_view(device, depthView);
+    RHI::Memory::Image::destroy_image_view(device, colorView);
+    RHI::Memory::free_memory(allocator, depthImage.second);
+    RHI::Memory::Image::destroy_image(device, depthImage.first);
+    RHI::Memory::free_memory(allocator, colorImage.second);
+    RHI::Memory::Image::destroy_image(device, colorImage.first);
+
+    RHI::Memory::destroy_allocator(allocator);
+    RHI::Device::destroy_logical_device(device);
+    RHI::Instance::destroy_instance(instance);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "transforms.hpp"
+#include "vulkan_minimal.hpp"
+
+// Compares writing model view projection matrices of N objects into mapped memory with glm, one object at a time,
+// against the structure of arrays kernels. No window required.
+
+using Clock = std::chrono::steady_clock;
+
+static double time_frames(uint32_t frameCount, const std::function<void()> &frame)
+{
+    // warm up
+    frame();
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < frameCount; ++i)
+        frame();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frameCount;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t objectCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 100000;
+    uint32_t frameCount = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 100;
+
+    RHI::load_symbols();
+    VkInstance instance = RHI::Instance::create_instance({}, {}, false);
+    VkPhysicalDevice physicalDevice = RHI::Device::get_physical_devices(instance)[0];
+    VkDevice device = RHI::Device::create_logical_device(instance, physicalDevice, nullptr, {}, {});
+    RHI::Memory::Allocator allocator = RHI::Memory::create_allocator(device, physicalDevice);
+
+    // the matrices are written where the frame would read them, usually write combined memory
+    auto matrixBuffer = RHI::Memory::Buffer::create_allocated_buffer(
+        device, allocator, sizeof(glm::mat4) * objectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    char *mapped = static_cast<char *>(matrixBuffer.second.mapped);
+
+    // same objects in both layouts
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    std::vector<glm::vec3> positions(objectCount);
+    std::vector<glm::quat> rotations(objectCount);
+    std::vector<glm::vec3> scales(objectCount);
+    Transforms::Store store;
+    Transforms::reserve(store, objectCount);
+    for (uint32_t i = 0; i < objectCount; ++i)
+    {
+        positions[i] = glm::vec3(unit(random), unit(random), unit(random)) * 100.f;
+        rotations[i] = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+        scales[i] = glm::vec3(1.f + 0.5f * unit(random));
+        Transforms::add_transform(store, positions[i], rotations[i], scales[i]);
+    }
+    glm::mat4 viewProj = glm::perspective(glm::radians(45.f), 16.f / 9.f, 0.1f, 1000.f) *
+                         glm::lookAt(glm::vec3(0.f, 50.f, 200.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+
+    std::vector<glm::mat4> reference(objectCount);
+    auto glmFrame = [&]() {
+        for (uint32_t i = 0; i < objectCount; ++i)
+        {
+            glm::mat4 model = glm::translate(glm::mat4(1.f), positions[i]) * glm::mat4_cast(rotations[i]) *
+                              glm::scale(glm::mat4(1.f), scales[i]);
+            glm::mat4 mvp = viewProj * model;
+            memcpy(mapped + i * sizeof(glm::mat4), &mvp, sizeof(mvp));
+        }
+    };
+    glmFrame();
+    memcpy(reference.data(), mapped, sizeof(glm::mat4) * objectCount);
+
+    std::cout << "path\tframe (ms)\tobject (ns)\tmax error" << std::endl;
+    double glmTime = time_frames(frameCount, glmFrame);
+    std::cout << "glm\t" << glmTime << "\t" << glmTime * 1e6 / objectCount << "\t0" << std::endl;
+
+    for (Transforms::Kernel kernel : {Transforms::Kernel::Scalar, Transforms::Kernel::SSE, Transforms::Kernel::AVX2})
+    {
+        if (!Transforms::is_kernel_supported(kernel))
+        {
+            std::cout << Transforms::get_kernel_name(kernel) << "\tnot compiled" << std::endl;
+            continue;
+        }
+
+        double kernelTime = time_frames(frameCount, [&]() {
+            Transforms::write_matrices(store, 0, objectCount, mapped, sizeof(glm::mat4), &viewProj, kernel);
+        });
+
+        // read back once, the mapped memory may be uncached
+        std::vector<float> result(16 * objectCount);
+        memcpy(result.data(), mapped, sizeof(glm::mat4) * objectCount);
+        const float *expected = reinterpret_cast<const float *>(reference.data());
+        float maxError = 0.f;
+        for (size_t i = 0; i < result.size(); ++i)
+            maxError = (std::max)(maxError, std::abs(result[i] - expected[i]));
+
+        std::cout << Transforms::get_kernel_name(kernel) << "\t" << kernelTime << "\t"
+                  << kernelTime * 1e6 / objectCount << "\t" << maxError << std::endl;
+    }
+
+    RHI::Memory::free_memory(allocator, matrixBuffer.second);
+    RHI::Memory::Buffer::destroy_buffer(device, matrixBuffer.first);
+    RHI::Memory::destroy_allocator(allocator);
+    RHI::Device::destroy_logical_device(device);
+    RHI::Instance::destroy_instance(instance);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "vulkan_minimal.hpp"
+
+// Bindless descriptors : every texture and buffer lives in a slot of a single set, bound once per frame
+namespace Bindless
+{
+constexpr uint32_t textureBinding = 0;
+constexpr uint32_t bufferBinding = 1;
+constexpr uint32_t invalidSlot = ~0u;
+
+/**
+ * @brief one set with an array of combined image samplers and an array of storage buffers, partially bound and
+ * updated after bind so that registering a resource never waits for the frames in flight
+ *
+ */
+struct Table
+{
+    VkDevice device;
+    VkDescriptorSetLayout setLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+
+    uint32_t maxTextureCount;
+    uint32_t maxBufferCount;
+
+    // resources may be registered from the loading threads, guards the slots and the descriptor set writes
+    std::mutex mutex;
+    uint32_t textureCount = 0;
+    uint32_t bufferCount = 0;
+    // released slots, reused before the arrays grow
+    std::vector<uint32_t> freeTextureSlots;
+    std::vector<uint32_t> freeBufferSlots;
+};
+
+inline bool is_supported(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceVulkan12Features features12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+    };
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &features12,
+    };
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    // the shaders select the buffer array element with a dynamically uniform index
+    return features.features.shaderStorageBufferArrayDynamicIndexing && features12.runtimeDescriptorArray &&
+           features12.descriptorBindingPartiallyBound &&
+           features12.descriptorBindingSampledImageUpdateAfterBind &&
+           features12.descriptorBindingStorageBufferUpdateAfterBind &&
+           features12.shaderSampledImageArrayNonUniformIndexing;
+}
+
+/**
+ * @brief Create a table object, the array sizes are clamped to the update after bind limits of the device
+ *
+ * @param device
+ * @param physicalDevice
+ * @param maxTextureCount
+ * @param maxBufferCount
+ * @return std::unique_ptr<Table> nullptr if descriptor indexing is not supported
+ */
+inline std::unique_ptr<Table> create_table(VkDevice device, VkPhysicalDevice physicalDevice,
+                                           uint32_t maxTextureCount = 4096, uint32_t maxBufferCount = 1024)
+{
+    if (!is_supported(physicalDevice))
+    {
+        std::cerr << "Descriptor indexing is not supported by the physical device" << std::endl;
+        return nullptr;
+    }
+
+    VkPhysicalDeviceVulkan12Properties properties12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES,
+    };
+    VkPhysicalDeviceProperties2 properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &properties12,
+    };
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    auto table = std::make_unique<Table>();
+    table->device = device;
+    table->maxTextureCount =
+        (std::min)({maxTextureCount, properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+                    properties12.maxPerStageDescriptorUpdateAfterBindSampledImages});
+    table->maxBufferCount = (std::min)({maxBufferCount, properties12.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                                        properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+
+    VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    VkDescriptorBindingFlags bindingFlags =
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    table->setLayout = RHI::Pipeline::Shader::create_descriptor_set_layout(
+        device,
+        {
+            {textureBinding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, table->maxTextureCount, stages, nullptr},
+            {bufferBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, table->maxBufferCount, stages, nullptr},
+        },
+        {bindingFlags, bindingFlags});
+    table->descriptorPool = RHI::Pipeline::Shader::create_descriptor_pool(
+        device,
+        {
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, table->maxTextureCount},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, table->maxBufferCount},
+        },
+        1, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+    table->descriptorSet =
+        RHI::Pipeline::Shader::allocate_desriptor_sets(device, table->descriptorPool, 1, {table->setLayout})[0];
+
+    return table;
+}
+
+inline void destroy_table(std::unique_ptr<Table> &table)
+{
+    RHI::Pipeline::Shader::destroy_descriptor_pool(table->device, table->descriptorPool);
+    RHI::Pipeline::Shader::destroy_descriptor_set_layout(table->device, table->setLayout);
+    table.reset();
+}
+
+inline uint32_t acquire_slot(std::vector<uint32_t> &freeSlots, uint32_t &count, uint32_t maxCount)
+{
+    if (!freeSlots.empty())
+    {
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    return count < maxCount ? count++ : invalidSlot;
+}
+
+/**
+ * @brief write a texture in a free slot, the slot index is stable until the texture is unregistered
+ *
+ * @return uint32_t index of the texture in the shaders' array, invalidSlot if the table is full
+ */
+inline uint32_t register_texture(Table &table, VkImageView imageView, VkSampler sampler,
+                                 VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+{
+    // vkUpdateDescriptorSets requires the set to be externally synchronized, the write stays under the lock
+    std::lock_guard<std::mutex> lock(table.mutex);
+    uint32_t slot = acquire_slot(table.freeTextureSlots, table.textureCount, table.maxTextureCount);
+    if (slot == invalidSlot)
+    {
+        std::cerr << "Failed to register texture : bindless table full" << std::endl;
+        return invalidSlot;
+    }
+
+    VkDescriptorImageInfo imageInfo = {
+        .sampler = sampler,
+        .imageView = imageView,
+        .imageLayout = imageLayout,
+    };
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = table.descriptorSet,
+        .dstBinding = textureBinding,
+        .dstArrayElement = slot,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &imageInfo,
+    };
+    RHI::Pipeline::Shader::write_descriptor_sets(table.device, {write});
+    return slot;
+}
+/**
+ * @brief write a storage buffer range in a free slot, the slot index is stable until the buffer is unregistered
+ *
+ * @return uint32_t index of the buffer in the shaders' array, invalidSlot if the table is full
+ */
+inline uint32_t register_buffer(Table &table, VkBuffer buffer, VkDeviceSize offset = 0,
+                                VkDeviceSize range = VK_WHOLE_SIZE)
+{
+    std::lock_guard<std::mutex> lock(table.mutex);
+    uint32_t slot = acquire_slot(table.freeBufferSlots, table.bufferCount, table.maxBufferCount);
+    if (slot == invalidSlot)
+    {
+        std::cerr << "Failed to register buffer : bindless table full" << std::endl;
+        return invalidSlot;
+    }
+
+    VkDescriptorBufferInfo bufferInfo = {
+        .buffer = buffer,
+        .offset = offset,
+        .range = range,
+    };
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = table.descriptorSet,
+        .dstBinding = bufferBinding,
+        .dstArrayElement = slot,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = &bufferInfo,
+    };
+    RHI::Pipeline::Shader::write_descriptor_sets(table.device, {write});
+    return slot;
+}
+
+/**
+ * @brief release a slot for a later registration, once the frames in flight using it are complete
+ *
+ * The descriptor is left as is, partially bound slots are only invalid if a shader reads them.
+ *
+ */
+inline void unregister_texture(Table &table, uint32_t slot)
+{
+    std::lock_guard<std::mutex> lock(table.mutex);
+    table.freeTextureSlots.emplace_back(slot);
+}
+inline void unregister_buffer(Table &table, uint32_t slot)
+{
+    std::lock_guard<std::mutex> lock(table.mutex);
+    table.freeBufferSlots.emplace_back(slot);
+}
+
+/**
+ * @brief bind the table once, the draws only push the indices of their resources
+ *
+ */
+inline void record_bind_table(const Table &table, VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint,
+                              VkPipelineLayout pipelineLayout, uint32_t setIndex)
+{
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, setIndex, 1, &table.descriptorSet, 0, nullptr);
+}
+} // namespace Bindless
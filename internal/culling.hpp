@@ -0,0 +1,339 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "storage_desc.hpp"
+#include "vulkan_minimal.hpp"
+
+// GPU-driven submission : a compute pass culls the objects against the frustum and writes their indirect draws
+namespace Culling
+{
+/**
+ * @brief object as read by the culling and vertex shaders, std430 layout
+ *
+ */
+struct ObjectData
+{
+    glm::mat4 model;
+    // center in model space and radius, the radius is scaled by the model scale on x
+    glm::vec4 boundingSphere;
+    // mesh range in the shared index and vertex buffers
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t padding = 0;
+};
+
+/**
+ * @brief per frame inputs of the culling shader, std140 layout
+ *
+ */
+struct CullData
+{
+    // planes facing inward, xyz normal and w distance
+    std::array<glm::vec4, 6> frustumPlanes;
+    uint32_t objectCount;
+    uint32_t padding[3] = {};
+};
+
+/**
+ * @brief left, right, bottom, top, near and far planes of a view projection matrix (Gribb and Hartmann), normalized
+ * so that the distances to the planes are in world units
+ *
+ */
+inline std::array<glm::vec4, 6> extract_frustum_planes(const glm::mat4 &viewProj)
+{
+    glm::vec4 row0 = {viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]};
+    glm::vec4 row1 = {viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]};
+    glm::vec4 row2 = {viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]};
+    glm::vec4 row3 = {viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]};
+
+    // Vulkan clip space depth is [0, w]
+    std::array<glm::vec4, 6> planes = {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2};
+    for (glm::vec4 &plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+    return planes;
+}
+
+struct Culler
+{
+    VkDevice device;
+    RHI::Memory::Allocator *allocator;
+
+    uint32_t maxObjectCount;
+    uint32_t objectCount = 0;
+
+    std::pair<VkBuffer, RHI::Memory::Allocation> objectBuffer;
+    // one VkDrawIndexedIndirectCommand per visible object, written by the culling shader, one per frame in flight so
+    // that a frame culled on another queue never overwrites the draws of the previous one
+    std::vector<std::pair<VkBuffer, RHI::Memory::Allocation>> drawBuffers;
+    std::vector<std::pair<VkBuffer, RHI::Memory::Allocation>> countBuffers;
+    // persistently mapped, one per frame in flight
+    std::vector<std::pair<VkBuffer, RHI::Memory::Allocation>> cullBuffers;
+
+    VkDescriptorSetLayout cullSetLayout;
+    VkPipelineLayout cullPipelineLayout;
+    VkPipeline cullPipeline;
+    // objects read by the vertex shader of the culled draws
+    VkDescriptorSetLayout drawSetLayout;
+
+    VkDescriptorPool descriptorPool;
+    std::vector<VkDescriptorSet> cullDescriptorSets;
+    VkDescriptorSet drawDescriptorSet;
+};
+
+/**
+ * @brief Create a culler object
+ *
+ * @param device
+ * @param allocator
+ * @param frameInFlightCount
+ * @param maxObjectCount capacity of the object and draw buffers
+ * @param shaderPath culling compute shader
+ * @param pipelineCache
+ * @param moduleCache
+ * @param objectFamilyIndices graphics and compute families when culling on an async compute queue, the objects are
+ * read by both
+ * @return std::unique_ptr<Culler> nullptr if the culling pipeline could not be created
+ */
+inline std::unique_ptr<Culler> create_culler(VkDevice device, RHI::Memory::Allocator &allocator,
+                                             uint32_t frameInFlightCount, uint32_t maxObjectCount,
+                                             const std::string &shaderPath = "shaders/cull.comp.spv",
+                                             VkPipelineCache pipelineCache = VK_NULL_HANDLE,
+                                             RHI::Pipeline::Shader::ModuleCache *moduleCache = nullptr,
+                                             const std::vector<uint32_t> &objectFamilyIndices = {})
+{
+    auto culler = std::make_unique<Culler>();
+    culler->device = device;
+    culler->allocator = &allocator;
+    culler->maxObjectCount = maxObjectCount;
+
+    culler->cullSetLayout = RHI::Pipeline::Shader::create_descriptor_set_layout(
+        device, {
+                    {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+                    StorageDesc::get_storage_buffer_layout_binding(1, VK_SHADER_STAGE_COMPUTE_BIT),
+                    StorageDesc::get_storage_buffer_layout_binding(2, VK_SHADER_STAGE_COMPUTE_BIT),
+                    StorageDesc::get_storage_buffer_layout_binding(3, VK_SHADER_STAGE_COMPUTE_BIT),
+                });
+    culler->cullPipelineLayout = RHI::Pipeline::Shader::create_pipeline_layout(device, {culler->cullSetLayout});
+    culler->cullPipeline = RHI::Pipeline::create_compute_pipeline(
+        device, {.stage = VK_SHADER_STAGE_COMPUTE_BIT, .path = shaderPath}, culler->cullPipelineLayout,
+        pipelineCache, moduleCache);
+    culler->drawSetLayout = RHI::Pipeline::Shader::create_descriptor_set_layout(
+        device, {StorageDesc::get_storage_buffer_layout_binding(0, VK_SHADER_STAGE_VERTEX_BIT)});
+    if (culler->cullPipeline == VK_NULL_HANDLE)
+    {
+        RHI::Pipeline::Shader::destroy_descriptor_set_layout(device, culler->drawSetLayout);
+        RHI::Pipeline::Shader::destroy_pipeline_layout(device, culler->cullPipelineLayout);
+        RHI::Pipeline::Shader::destroy_descriptor_set_layout(device, culler->cullSetLayout);
+        return nullptr;
+    }
+
+    culler->objectBuffer = RHI::Memory::Buffer::create_allocated_buffer(
+        device, allocator, sizeof(ObjectData) * maxObjectCount,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        objectFamilyIndices);
+    for (uint32_t i = 0; i < frameInFlightCount; ++i)
+    {
+        culler->drawBuffers.emplace_back(RHI::Memory::Buffer::create_allocated_buffer(
+            device, allocator, sizeof(VkDrawIndexedIndirectCommand) * maxObjectCount,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT));
+        culler->countBuffers.emplace_back(RHI::Memory::Buffer::create_allocated_buffer(
+            device, allocator, sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT));
+        culler->cullBuffers.emplace_back(RHI::Memory::Buffer::create_allocated_buffer(
+            device, allocator, sizeof(CullData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    }
+
+    // the storage buffers of the cull sets and the objects of the draw set
+    std::vector<VkDescriptorPoolSize> poolSizes =
+        StorageDesc::get_storage_descriptor_pool_sizes(1, 3 * frameInFlightCount + 1);
+    poolSizes.emplace_back(VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameInFlightCount});
+    culler->descriptorPool =
+        RHI::Pipeline::Shader::create_descriptor_pool(device, poolSizes, frameInFlightCount + 1);
+    culler->cullDescriptorSets = RHI::Pipeline::Shader::allocate_desriptor_sets(
+        device, culler->descriptorPool, frameInFlightCount,
+        std::vector<VkDescriptorSetLayout>(frameInFlightCount, culler->cullSetLayout));
+    culler->drawDescriptorSet =
+        RHI::Pipeline::Shader::allocate_desriptor_sets(device, culler->descriptorPool, 1, {culler->drawSetLayout})[0];
+
+    VkDescriptorBufferInfo objectInfo = {culler->objectBuffer.first, 0, VK_WHOLE_SIZE};
+    std::vector<VkDescriptorBufferInfo> drawInfos(frameInFlightCount);
+    std::vector<VkDescriptorBufferInfo> countInfos(frameInFlightCount);
+    std::vector<VkDescriptorBufferInfo> cullInfos(frameInFlightCount);
+    std::vector<VkWriteDescriptorSet> writes;
+    for (uint32_t i = 0; i < frameInFlightCount; ++i)
+    {
+        drawInfos[i] = {culler->drawBuffers[i].first, 0, VK_WHOLE_SIZE};
+        countInfos[i] = {culler->countBuffers[i].first, 0, VK_WHOLE_SIZE};
+        cullInfos[i] = {culler->cullBuffers[i].first, 0, sizeof(CullData)};
+        writes.emplace_back(VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = culler->cullDescriptorSets[i],
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .pBufferInfo = &cullInfos[i],
+        });
+        writes.emplace_back(StorageDesc::get_storage_buffer_descriptor_set_write(culler->cullDescriptorSets[i], 1,
+                                                                                 objectInfo));
+        writes.emplace_back(
+            StorageDesc::get_storage_buffer_descriptor_set_write(culler->cullDescriptorSets[i], 2, drawInfos[i]));
+        writes.emplace_back(
+            StorageDesc::get_storage_buffer_descriptor_set_write(culler->cullDescriptorSets[i], 3, countInfos[i]));
+    }
+    writes.emplace_back(StorageDesc::get_storage_buffer_descriptor_set_write(culler->drawDescriptorSet, 0, objectInfo));
+    RHI::Pipeline::Shader::write_descriptor_sets(device, writes);
+
+    return culler;
+}
+
+inline void destroy_culler(std::unique_ptr<Culler> &culler)
+{
+    VkDevice device = culler->device;
+    RHI::Pipeline::Shader::destroy_descriptor_pool(device, culler->descriptorPool);
+    for (auto *buffers : {&culler->cullBuffers, &culler->drawBuffers, &culler->countBuffers})
+    {
+        for (auto &[buffer, allocation] : *buffers)
+        {
+            RHI::Memory::free_memory(*culler->allocator, allocation);
+            RHI::Memory::Buffer::destroy_buffer(device, buffer);
+        }
+    }
+    RHI::Memory::free_memory(*culler->allocator, culler->objectBuffer.second);
+    RHI::Memory::Buffer::destroy_buffer(device, culler->objectBuffer.first);
+    RHI::Pipeline::destroy_pipeline(device, culler->cullPipeline);
+    RHI::Pipeline::Shader::destroy_descriptor_set_layout(device, culler->drawSetLayout);
+    RHI::Pipeline::Shader::destroy_pipeline_layout(device, culler->cullPipelineLayout);
+    RHI::Pipeline::Shader::destroy_descriptor_set_layout(device, culler->cullSetLayout);
+    culler.reset();
+}
+
+/**
+ * @brief replace the objects, through the staging ring so that they are usable once the ring is flushed
+ *
+ * The objects must not be replaced while a frame in flight culls them. Culled on an async compute queue, the
+ * submissions must also wait for the upload value returned by the flush.
+ *
+ */
+inline void upload_objects(Culler &culler, RHI::Memory::Staging::Ring &stagingRing,
+                           const std::vector<ObjectData> &objects)
+{
+    culler.objectCount = static_cast<uint32_t>((std::min)(objects.size(), static_cast<size_t>(culler.maxObjectCount)));
+    if (culler.objectCount == 0)
+        return;
+    RHI::Memory::Staging::upload_to_buffer(stagingRing, culler.objectBuffer.first, 0, objects.data(),
+                                           sizeof(ObjectData) * culler.objectCount);
+}
+
+/**
+ * @brief ownership transfer of the draws of a frame from the culling queue family to the drawing one
+ *
+ */
+inline std::vector<VkBufferMemoryBarrier> get_draw_ownership_barriers(const Culler &culler,
+                                                                      uint32_t frameInFlightIndex,
+                                                                      uint32_t computeFamilyIndex,
+                                                                      uint32_t graphicsFamilyIndex)
+{
+    std::vector<VkBufferMemoryBarrier> barriers;
+    for (const auto *buffers : {&culler.drawBuffers, &culler.countBuffers})
+    {
+        VkBuffer buffer = (*buffers)[frameInFlightIndex].first;
+        barriers.emplace_back(RHI::Compute::get_ownership_transfer_barrier(
+            buffer, computeFamilyIndex, graphicsFamilyIndex, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT));
+    }
+    return barriers;
+}
+
+/**
+ * @brief record the culling of the objects, outside of the render pass and before the culled draws
+ *
+ * On an async compute queue, the draws are released to the graphics family and acquired with
+ * record_acquire_culled_draws. The draws of the frame were last read before its fence, they are overwritten without
+ * acquiring them back.
+ *
+ * @param culler
+ * @param commandBuffer
+ * @param frameInFlightIndex selects the frustum buffer, written by the host right away, and the draw buffers
+ * @param viewProj
+ * @param computeFamilyIndex family of the queue running commandBuffer
+ * @param graphicsFamilyIndex family of the queue drawing, the same as computeFamilyIndex without async compute
+ */
+inline void record_cull(Culler &culler, VkCommandBuffer commandBuffer, uint32_t frameInFlightIndex,
+                        const glm::mat4 &viewProj, uint32_t computeFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                        uint32_t graphicsFamilyIndex = VK_QUEUE_FAMILY_IGNORED)
+{
+    CullData cullData = {
+        .frustumPlanes = extract_frustum_planes(viewProj),
+        .objectCount = culler.objectCount,
+    };
+    memcpy(culler.cullBuffers[frameInFlightIndex].second.mapped, &cullData, sizeof(cullData));
+
+    // the count is cleared by a transfer
+    vkCmdFillBuffer(commandBuffer, culler.countBuffers[frameInFlightIndex].first, 0, sizeof(uint32_t), 0);
+    RHI::Compute::record_compute_overwrite_barrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                                   VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    RHI::Compute::record_bind_compute_pipeline(commandBuffer, culler.cullPipeline, culler.cullPipelineLayout,
+                                               {culler.cullDescriptorSets[frameInFlightIndex]});
+    // 64 invocations per workgroup as in the shader
+    RHI::Compute::record_dispatch(commandBuffer, RHI::Compute::get_group_count(culler.objectCount, 64));
+
+    if (RHI::Compute::is_async_compute(graphicsFamilyIndex, computeFamilyIndex))
+    {
+        RHI::Compute::record_release_barriers(
+            commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            get_draw_ownership_barriers(culler, frameInFlightIndex, computeFamilyIndex, graphicsFamilyIndex));
+    }
+    else
+    {
+        RHI::Compute::record_compute_write_barrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                                                   VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    }
+}
+/**
+ * @brief acquire the draws culled on an async compute queue, outside of the render pass of the graphics queue
+ *
+ */
+inline void record_acquire_culled_draws(const Culler &culler, VkCommandBuffer commandBuffer,
+                                        uint32_t frameInFlightIndex, uint32_t computeFamilyIndex,
+                                        uint32_t graphicsFamilyIndex)
+{
+    RHI::Compute::record_acquire_barriers(
+        commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        get_draw_ownership_barriers(culler, frameInFlightIndex, computeFamilyIndex, graphicsFamilyIndex));
+}
+
+/**
+ * @brief draw the objects that passed the culling, the object index reaches the vertex shader as gl_InstanceIndex
+ *
+ * @param culler
+ * @param commandBuffer
+ * @param frameInFlightIndex the frame culled by record_cull
+ * @param pipelineLayout graphics pipeline layout with the draw set layout of the culler at setIndex
+ * @param setIndex
+ * @param vertexBuffer shared by every object
+ * @param indexBuffer shared by every object
+ */
+inline void record_culled_draws(const Culler &culler, VkCommandBuffer commandBuffer, uint32_t frameInFlightIndex,
+                                VkPipelineLayout pipelineLayout, uint32_t setIndex, VkBuffer vertexBuffer,
+                                VkBuffer indexBuffer)
+{
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, setIndex, 1,
+                            &culler.drawDescriptorSet, 0, nullptr);
+    RHI::Render::record_back_buffer_draw_indexed_indirect_count_commands(
+        commandBuffer, vertexBuffer, indexBuffer, culler.drawBuffers[frameInFlightIndex].first,
+        culler.countBuffers[frameInFlightIndex].first, culler.maxObjectCount);
+}
+} // namespace Culling
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing job scheduler
+namespace Jobs
+{
+/**
+ * @brief a job receives the index of the thread running it, 0 being the thread owning the scheduler
+ *
+ */
+using Job = std::function<void(uint32_t threadIndex)>;
+
+/**
+ * @brief jobs of a thread, the owner pops from the back while the other threads steal from the front
+ *
+ */
+struct WorkQueue
+{
+    std::mutex mutex;
+    std::deque<Job> jobs;
+};
+
+struct Scheduler
+{
+    // one queue per thread, index 0 belongs to the thread owning the scheduler
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<bool> bRunning = true;
+    std::atomic<uint32_t> pendingJobCount = 0;
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+};
+
+/**
+ * @brief number of jobs left, decremented when a job completes
+ *
+ */
+using Counter = std::atomic<uint32_t>;
+
+inline uint32_t get_thread_count(const Scheduler &scheduler)
+{
+    return static_cast<uint32_t>(scheduler.queues.size());
+}
+
+inline void push_job(Scheduler &scheduler, uint32_t threadIndex, Job job)
+{
+    // counted before being visible so that a thief never decrements below zero
+    {
+        std::lock_guard<std::mutex> lock(scheduler.sleepMutex);
+        ++scheduler.pendingJobCount;
+    }
+    {
+        std::lock_guard<std::mutex> lock(scheduler.queues[threadIndex]->mutex);
+        scheduler.queues[threadIndex]->jobs.emplace_back(std::move(job));
+    }
+    scheduler.wakeCondition.notify_one();
+}
+
+/**
+ * @brief pop a job from the queue of the thread, or steal one from another thread
+ *
+ * @return bool false if every queue is empty
+ */
+inline bool try_pop_job(Scheduler &scheduler, uint32_t threadIndex, Job &job)
+{
+    {
+        WorkQueue &queue = *scheduler.queues[threadIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            --scheduler.pendingJobCount;
+            return true;
+        }
+    }
+
+    uint32_t threadCount = get_thread_count(scheduler);
+    for (uint32_t i = 1; i < threadCount; ++i)
+    {
+        WorkQueue &victim = *scheduler.queues[(threadIndex + i) % threadCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty())
+        {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            --scheduler.pendingJobCount;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline void worker_loop(Scheduler &scheduler, uint32_t threadIndex)
+{
+    Job job;
+    while (scheduler.bRunning)
+    {
+        if (try_pop_job(scheduler, threadIndex, job))
+        {
+            job(threadIndex);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(scheduler.sleepMutex);
+        scheduler.wakeCondition.wait(lock,
+                                     [&scheduler] { return scheduler.pendingJobCount > 0 || !scheduler.bRunning; });
+    }
+}
+
+/**
+ * @brief Create a scheduler object
+ *
+ * @param workerCount threads spawned in addition to the calling thread
+ * @return std::unique_ptr<Scheduler>
+ */
+inline std::unique_ptr<Scheduler> create_scheduler(
+    uint32_t workerCount = (std::max)(std::thread::hardware_concurrency(), 2u) - 1)
+{
+    auto scheduler = std::make_unique<Scheduler>();
+    for (uint32_t i = 0; i < workerCount + 1; ++i)
+        scheduler->queues.emplace_back(std::make_unique<WorkQueue>());
+    for (uint32_t i = 1; i < workerCount + 1; ++i)
+        scheduler->workers.emplace_back(worker_loop, std::ref(*scheduler), i);
+
+    return scheduler;
+}
+inline void destroy_scheduler(std::unique_ptr<Scheduler> &scheduler)
+{
+    {
+        std::lock_guard<std::mutex> lock(scheduler->sleepMutex);
+        scheduler->bRunning = false;
+    }
+    scheduler->wakeCondition.notify_all();
+    for (std::thread &worker : scheduler->workers)
+        worker.join();
+
+    scheduler.reset();
+}
+
+/**
+ * @brief run jobs on the calling thread until the counter reaches zero
+ *
+ */
+inline void wait(Scheduler &scheduler, uint32_t threadIndex, const Counter &counter)
+{
+    Job job;
+    while (counter > 0)
+    {
+        if (try_pop_job(scheduler, threadIndex, job))
+            job(threadIndex);
+        else
+            std::this_thread::yield();
+    }
+}
+
+/**
+ * @brief split [0, count) in ranges of grainSize processed in parallel, the calling thread takes part in the work
+ *
+ * Must be called from the thread owning the scheduler (thread index 0).
+ *
+ * @param scheduler
+ * @param count
+ * @param grainSize
+ * @param function called with (begin, end, threadIndex)
+ */
+inline void parallel_for(Scheduler &scheduler, uint32_t count, uint32_t grainSize,
+                         const std::function<void(uint32_t, uint32_t, uint32_t)> &function)
+{
+    grainSize = (std::max)(grainSize, 1u);
+    Counter counter = (count + grainSize - 1) / grainSize;
+    for (uint32_t begin = 0; begin < count; begin += grainSize)
+    {
+        uint32_t end = (std::min)(begin + grainSize, count);
+        push_job(scheduler, 0, [&function, &counter, begin, end](uint32_t threadIndex) {
+            function(begin, end, threadIndex);
+            --counter;
+        });
+    }
+
+    wait(scheduler, 0, counter);
+}
+} // namespace Jobs
@@ -0,0 +1,378 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "vertex.hpp"
+
+// Index and vertex reordering for the post transform vertex cache, overdraw and vertex fetch. Every step only
+// depends on its input so that the result of a mesh can be cached offline.
+namespace MeshOptimizer
+{
+constexpr uint32_t invalidIndex = ~0u;
+
+/**
+ * @brief simulated FIFO post transform cache
+ *
+ * ACMR : average cache miss ratio, vertices transformed per triangle (0.5 is ideal for large regular meshes, 3 is
+ * the worst). ATVR : average transformed vertex ratio, vertices transformed per vertex (1 is ideal).
+ *
+ */
+struct CacheStatistics
+{
+    uint32_t missCount = 0;
+    float acmr = 0.f;
+    float atvr = 0.f;
+};
+
+template <typename Index>
+inline CacheStatistics analyze_vertex_cache(const std::vector<Index> &indices, uint32_t vertexCount,
+                                            uint32_t cacheSize = 16)
+{
+    // a vertex is in the cache while fewer than cacheSize vertices have been inserted after it
+    std::vector<uint32_t> insertionTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+
+    CacheStatistics stats;
+    for (Index index : indices)
+    {
+        if (time - insertionTime[index] > cacheSize)
+        {
+            insertionTime[index] = time++;
+            ++stats.missCount;
+        }
+    }
+    size_t triangleCount = indices.size() / 3;
+    stats.acmr = triangleCount > 0 ? static_cast<float>(stats.missCount) / triangleCount : 0.f;
+    stats.atvr = vertexCount > 0 ? static_cast<float>(stats.missCount) / vertexCount : 0.f;
+    return stats;
+}
+
+/**
+ * @brief merge the bitwise identical vertices, the first occurrence is kept in place of the others
+ *
+ * V must have no padding.
+ *
+ */
+template <typename V, typename Index>
+inline void deduplicate_vertices(std::vector<V> &vertices, std::vector<Index> &indices)
+{
+    static_assert(std::is_trivially_copyable_v<V>, "Vertices are compared and hashed bytewise");
+
+    // open addressing, at most half full
+    size_t tableSize = 1;
+    while (tableSize < vertices.size() * 2)
+        tableSize *= 2;
+    std::vector<uint32_t> table(tableSize, invalidIndex);
+
+    std::vector<V> uniqueVertices;
+    uniqueVertices.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        // FNV-1a
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&vertices[i]);
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t b = 0; b < sizeof(V); ++b)
+        {
+            hash ^= bytes[b];
+            hash *= 1099511628211ull;
+        }
+
+        size_t slot = hash & (tableSize - 1);
+        while (table[slot] != invalidIndex && memcmp(&uniqueVertices[table[slot]], &vertices[i], sizeof(V)) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+        if (table[slot] == invalidIndex)
+        {
+            table[slot] = static_cast<uint32_t>(uniqueVertices.size());
+            uniqueVertices.emplace_back(vertices[i]);
+        }
+        remap[i] = table[slot];
+    }
+
+    for (Index &index : indices)
+        index = static_cast<Index>(remap[index]);
+    vertices = std::move(uniqueVertices);
+}
+
+/**
+ * @brief Tipsify (Sander, Nehab and Barczak 2007) : fan out of a vertex, then continue with the vertex of the fan
+ * that is most likely to still be in the cache
+ *
+ * Linear in the number of indices, the order of the triangles adjacent to a vertex is their input order.
+ *
+ */
+template <typename Index>
+inline void optimize_vertex_cache(std::vector<Index> &indices, uint32_t vertexCount, uint32_t cacheSize = 16)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    // triangles adjacent to each vertex
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (Index index : indices)
+        ++liveTriangles[index];
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacencyCursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency[adjacencyCursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    // vertices of the emitted triangles, the candidates when the fan ends in a dead end
+    std::vector<uint32_t> deadEndStack;
+    std::vector<uint32_t> candidates;
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0;
+
+    std::vector<Index> output;
+    output.reserve(indices.size());
+
+    auto skip_dead_end = [&]() -> uint32_t {
+        while (!deadEndStack.empty())
+        {
+            uint32_t v = deadEndStack.back();
+            deadEndStack.pop_back();
+            if (liveTriangles[v] > 0)
+                return v;
+        }
+        while (cursor < vertexCount && liveTriangles[cursor] == 0)
+            ++cursor;
+        return cursor < vertexCount ? cursor : invalidIndex;
+    };
+
+    uint32_t fanning = skip_dead_end();
+    while (fanning != invalidIndex)
+    {
+        candidates.clear();
+        for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; ++a)
+        {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = true;
+            for (int k = 0; k < 3; ++k)
+            {
+                Index v = indices[triangle * 3 + k];
+                output.emplace_back(v);
+                deadEndStack.emplace_back(v);
+                candidates.emplace_back(v);
+                --liveTriangles[v];
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+        }
+
+        // the candidate staying in the cache the longest while its remaining triangles are emitted
+        uint32_t next = invalidIndex;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                priority = time - cacheTime[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+        fanning = next != invalidIndex ? next : skip_dead_end();
+    }
+
+    indices = std::move(output);
+}
+
+/**
+ * @brief group the triangles in clusters at the cache boundaries, then draw the clusters facing away from the
+ * center of the mesh first so that they occlude the rest from most view points
+ *
+ * Runs after optimize_vertex_cache, the order inside the clusters is kept. A cluster is split where its running
+ * ACMR is within threshold of its overall ACMR, a higher threshold gives smaller clusters, less overdraw and more
+ * cache misses.
+ *
+ */
+template <typename Index>
+inline void optimize_overdraw(std::vector<Index> &indices, const std::vector<Vertex> &vertices,
+                              uint32_t cacheSize = 16, float threshold = 1.05f)
+{
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0)
+        return;
+
+    std::vector<uint32_t> cacheTime(vertices.size(), 0);
+    uint32_t time = cacheSize + 1;
+    auto get_triangle_misses = [&](uint32_t triangle) {
+        uint32_t misses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            Index v = indices[triangle * 3 + k];
+            if (time - cacheTime[v] > cacheSize)
+            {
+                cacheTime[v] = time++;
+                ++misses;
+            }
+        }
+        return misses;
+    };
+    auto flush_cache = [&]() { time += cacheSize + 1; };
+
+    // hard boundaries : triangles whose three vertices miss the cache, the first cluster begins at the first
+    // triangle even if it is degenerate
+    std::vector<uint32_t> hardBoundaries = {0};
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        if (get_triangle_misses(t) == 3 && t > 0)
+            hardBoundaries.emplace_back(t);
+    }
+    hardBoundaries.emplace_back(triangleCount);
+
+    // soft boundaries inside each hard cluster
+    std::vector<uint32_t> clusterBegins;
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+    {
+        uint32_t begin = hardBoundaries[h];
+        uint32_t end = hardBoundaries[h + 1];
+
+        flush_cache();
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; ++t)
+            clusterMisses += get_triangle_misses(t);
+        float clusterAcmr = static_cast<float>(clusterMisses) / (end - begin);
+
+        flush_cache();
+        clusterBegins.emplace_back(begin);
+        uint32_t softBegin = begin;
+        uint32_t misses = 0;
+        for (uint32_t t = begin; t < end; ++t)
+        {
+            misses += get_triangle_misses(t);
+            if (t + 1 < end && static_cast<float>(misses) / (t + 1 - softBegin) <= clusterAcmr * threshold)
+            {
+                softBegin = t + 1;
+                misses = 0;
+                clusterBegins.emplace_back(softBegin);
+                flush_cache();
+            }
+        }
+    }
+    clusterBegins.emplace_back(triangleCount);
+
+    glm::vec3 meshCentroid(0.f);
+    for (const Vertex &vertex : vertices)
+        meshCentroid = meshCentroid + vertex.position;
+    meshCentroid = meshCentroid * (1.f / std::max<size_t>(vertices.size(), 1));
+
+    // area weighted centroid and normal of each cluster
+    uint32_t clusterCount = static_cast<uint32_t>(clusterBegins.size() - 1);
+    std::vector<float> sortKeys(clusterCount);
+    for (uint32_t c = 0; c < clusterCount; ++c)
+    {
+        glm::vec3 centroid(0.f);
+        glm::vec3 normal(0.f);
+        float area = 0.f;
+        for (uint32_t t = clusterBegins[c]; t < clusterBegins[c + 1]; ++t)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(triangleNormal);
+            centroid = centroid + (p0 + p1 + p2) * (triangleArea / 3.f);
+            normal = normal + triangleNormal;
+            area += triangleArea;
+        }
+        float normalLength = glm::length(normal);
+        if (area > 0.f)
+            centroid = centroid * (1.f / area);
+        if (normalLength > 0.f)
+            normal = normal * (1.f / normalLength);
+        sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+    }
+
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    for (uint32_t c = 0; c < clusterCount; ++c)
+        clusterOrder[c] = c;
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+                     [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<Index> output;
+    output.reserve(indices.size());
+    for (uint32_t c : clusterOrder)
+        output.insert(output.end(), indices.begin() + clusterBegins[c] * 3, indices.begin() + clusterBegins[c + 1] * 3);
+    indices = std::move(output);
+}
+
+/**
+ * @brief renumber the vertices in their order of first use so that the vertex fetch reads memory linearly, the
+ * unreferenced vertices are removed
+ *
+ */
+template <typename V, typename Index>
+inline void optimize_vertex_fetch(std::vector<V> &vertices, std::vector<Index> &indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), invalidIndex);
+    std::vector<V> fetchOrderedVertices;
+    fetchOrderedVertices.reserve(vertices.size());
+    for (Index &index : indices)
+    {
+        if (remap[index] == invalidIndex)
+        {
+            remap[index] = static_cast<uint32_t>(fetchOrderedVertices.size());
+            fetchOrderedVertices.emplace_back(vertices[index]);
+        }
+        index = static_cast<Index>(remap[index]);
+    }
+    vertices = std::move(fetchOrderedVertices);
+}
+
+struct Report
+{
+    uint32_t vertexCountBefore = 0;
+    uint32_t vertexCountAfter = 0;
+    CacheStatistics before;
+    CacheStatistics after;
+};
+
+/**
+ * @brief every step in order : deduplication, vertex cache, overdraw then vertex fetch
+ *
+ * @param vertices
+ * @param indices triangle list
+ * @param cacheSize entries of the simulated cache, 16 to 32 on current GPUs
+ * @return Report ACMR and ATVR before and after
+ */
+template <typename Index>
+inline Report optimize_mesh(std::vector<Vertex> &vertices, std::vector<Index> &indices, uint32_t cacheSize = 16)
+{
+    Report report;
+    report.vertexCountBefore = static_cast<uint32_t>(vertices.size());
+    report.before = analyze_vertex_cache(indices, report.vertexCountBefore, cacheSize);
+
+    deduplicate_vertices(vertices, indices);
+    optimize_vertex_cache(indices, static_cast<uint32_t>(vertices.size()), cacheSize);
+    optimize_overdraw(indices, vertices, cacheSize);
+    optimize_vertex_fetch(vertices, indices);
+
+    report.vertexCountAfter = static_cast<uint32_t>(vertices.size());
+    report.after = analyze_vertex_cache(indices, report.vertexCountAfter, cacheSize);
+    return report;
+}
+
+inline void print_report(const Report &report)
+{
+    std::cout << "mesh vertices : " << report.vertexCountBefore << " -> " << report.vertexCountAfter << '\n'
+              << "\tACMR : " << report.before.acmr << " -> " << report.after.acmr << '\n'
+              << "\tATVR : " << report.before.atvr << " -> " << report.after.atvr << '\n';
+}
+} // namespace MeshOptimizer
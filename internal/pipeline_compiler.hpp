@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "jobs.hpp"
+#include "vulkan_minimal.hpp"
+
+namespace RHI
+{
+namespace Pipeline
+{
+// Background pipeline compilation
+namespace Compiler
+{
+/**
+ * @brief pipeline being compiled, the handle stays valid until the compiler is destroyed
+ *
+ */
+using PipelineHandle = std::shared_ptr<RegisteredPipeline>;
+
+struct Compiler
+{
+    // dedicated threads so that compilations never run on the threads recording the frame
+    std::unique_ptr<Jobs::Scheduler> scheduler;
+    uint32_t nextThreadIndex = 0;
+
+    // requests with the same desc share their handle, the registry is only accessed under the mutex
+    std::mutex mutex;
+    Registry registry;
+    // invalidated pipelines, possibly still used by frames in flight
+    struct RetiredPipeline
+    {
+        PipelineHandle handle;
+        uint64_t lastUsedFrame;
+    };
+    std::vector<RetiredPipeline> retiredPipelines;
+
+    // bound in place of pipelines that are not ready yet, VK_NULL_HANDLE to skip their draws instead
+    VkPipeline fallbackPipeline = VK_NULL_HANDLE;
+};
+
+/**
+ * @brief Create a compiler object
+ *
+ * @param device
+ * @param pipelineCache shared by every compilation, vkCreateGraphicsPipelines synchronizes the accesses to it
+ * @param moduleCache shared by every compilation, nullptr to load the shaders for each pipeline
+ * @param workerCount 0 compiles synchronously on the requesting thread
+ * @return std::unique_ptr<Compiler>
+ */
+inline std::unique_ptr<Compiler> create_compiler(VkDevice device, VkPipelineCache pipelineCache,
+                                                 Shader::ModuleCache *moduleCache = nullptr,
+                                                 uint32_t workerCount = (std::max)(std::thread::hardware_concurrency(),
+                                                                                   4u) / 4)
+{
+    auto compiler = std::make_unique<Compiler>();
+    compiler->registry = create_registry(device, pipelineCache, moduleCache);
+    compiler->scheduler = Jobs::create_scheduler(workerCount);
+    return compiler;
+}
+
+/**
+ * @brief the fallback must be compatible with the render pass of the pipelines it replaces
+ *
+ */
+inline void set_fallback_pipeline(Compiler &compiler, VkPipeline fallbackPipeline)
+{
+    compiler.fallbackPipeline = fallbackPipeline;
+}
+
+/**
+ * @brief queue the compilation of a pipeline on the compiler threads, unless the same desc has already been requested
+ *
+ * A desc whose compilation failed is compiled again.
+ *
+ * @param compiler
+ * @param desc
+ * @return PipelineHandle to query with get_pipeline
+ */
+inline PipelineHandle request_pipeline(Compiler &compiler, const PipelineDesc &desc)
+{
+    PipelineHandle handle;
+    {
+        std::lock_guard<std::mutex> lock(compiler.mutex);
+        if (!find_or_register_pipeline(compiler.registry, desc, handle))
+            return handle;
+    }
+
+    uint32_t workerCount = Jobs::get_thread_count(*compiler.scheduler) - 1;
+    if (workerCount == 0)
+    {
+        compile_pipeline(compiler.registry, *handle);
+        return handle;
+    }
+
+    // spread the requests over the workers, the idle ones steal the remaining work
+    uint32_t threadIndex = 1 + compiler.nextThreadIndex++ % workerCount;
+    Jobs::push_job(*compiler.scheduler, threadIndex,
+                   [&compiler, handle](uint32_t) { compile_pipeline(compiler.registry, *handle); });
+
+    return handle;
+}
+
+inline bool is_pipeline_ready(const PipelineHandle &handle)
+{
+    return handle->bReady;
+}
+/**
+ * @brief never blocks
+ *
+ * @return VkPipeline the compiled pipeline, or the fallback pipeline while it is not ready or if it failed
+ */
+inline VkPipeline get_pipeline(const Compiler &compiler, const PipelineHandle &handle)
+{
+    VkPipeline pipeline = handle->bReady ? handle->pipeline.load() : VK_NULL_HANDLE;
+    return pipeline != VK_NULL_HANDLE ? pipeline : compiler.fallbackPipeline;
+}
+/**
+ * @brief block until the pipeline is compiled
+ *
+ */
+inline VkPipeline wait_pipeline(const PipelineHandle &handle)
+{
+    while (!handle->bReady)
+        std::this_thread::yield();
+    return handle->pipeline;
+}
+
+/**
+ * @brief forget the pipelines using a shader so that requesting them again compiles them again, e.g. on hot reload
+ *
+ * The handles already returned stay valid, their pipelines are destroyed by collect_retired_pipelines once released.
+ *
+ * @param compiler
+ * @param shaderPath
+ * @param frameNumber frame being recorded
+ * @return uint32_t number of pipelines invalidated
+ */
+inline uint32_t invalidate_pipelines(Compiler &compiler, const std::string &shaderPath, uint64_t frameNumber)
+{
+    std::lock_guard<std::mutex> lock(compiler.mutex);
+    uint32_t invalidatedCount = 0;
+    for (auto &[hash, handles] : compiler.registry.pipelines)
+    {
+        for (auto handle = handles.begin(); handle != handles.end();)
+        {
+            const std::vector<ShaderStageDesc> &shaderStages = (*handle)->desc.shaderStages;
+            bool bUsesShader =
+                std::any_of(shaderStages.begin(), shaderStages.end(),
+                            [&shaderPath](const ShaderStageDesc &stage) { return stage.path == shaderPath; });
+            if (!bUsesShader)
+            {
+                ++handle;
+                continue;
+            }
+
+            compiler.retiredPipelines.emplace_back(std::move(*handle), frameNumber);
+            handle = handles.erase(handle);
+            ++invalidatedCount;
+        }
+    }
+    return invalidatedCount;
+}
+
+/**
+ * @brief destroy the invalidated pipelines that no frame in flight can use anymore
+ *
+ * A retired pipeline is used by the frame being recorded as long as a handle to it is held outside the compiler.
+ * Call after waiting for the fence of the frame being recorded.
+ *
+ * @param compiler
+ * @param frameNumber frame being recorded
+ * @param frameInFlightCount the frame frameNumber - frameInFlightCount has completed
+ * @return uint32_t number of pipelines destroyed
+ */
+inline uint32_t collect_retired_pipelines(Compiler &compiler, uint64_t frameNumber, uint32_t frameInFlightCount)
+{
+    std::lock_guard<std::mutex> lock(compiler.mutex);
+    uint32_t destroyedCount = 0;
+    for (auto retired = compiler.retiredPipelines.begin(); retired != compiler.retiredPipelines.end();)
+    {
+        if (retired->handle.use_count() > 1)
+            retired->lastUsedFrame = frameNumber;
+
+        // a pending compilation completes first
+        if (!retired->handle->bReady || frameNumber < retired->lastUsedFrame + frameInFlightCount)
+        {
+            ++retired;
+            continue;
+        }
+
+        destroy_pipeline(compiler.registry.device, retired->handle->pipeline);
+        retired = compiler.retiredPipelines.erase(retired);
+        ++destroyedCount;
+    }
+    return destroyedCount;
+}
+
+/**
+ * @brief wait for the pending compilations and destroy every pipeline compiled, the fallback pipeline is not owned
+ *
+ */
+inline void destroy_compiler(std::unique_ptr<Compiler> &compiler)
+{
+    for (const auto &[hash, handles] : compiler->registry.pipelines)
+    {
+        for (const PipelineHandle &handle : handles)
+            wait_pipeline(handle);
+    }
+    destroy_registry(compiler->registry);
+    for (const Compiler::RetiredPipeline &retired : compiler->retiredPipelines)
+        destroy_pipeline(compiler->registry.device, wait_pipeline(retired.handle));
+    compiler->retiredPipelines.clear();
+
+    Jobs::destroy_scheduler(compiler->scheduler);
+    compiler.reset();
+}
+} // namespace Compiler
+} // namespace Pipeline
+} // namespace RHI
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "vertex_desc.hpp"
+
+namespace RHI
+{
+namespace Pipeline
+{
+struct ShaderStageDesc
+{
+    VkShaderStageFlagBits stage;
+    // SPIR-V file
+    std::string path;
+    std::string entryPoint = "main";
+
+    // specialization constants, entries sorted by constant ID and their values packed in the data in the same order
+    std::vector<VkSpecializationMapEntry> specializationEntries;
+    std::vector<char> specializationData;
+};
+
+/**
+ * @brief set the value of a constant_id of the shader, the driver compiles the shader with the constant folded
+ *
+ * @tparam T bool, int32_t, uint32_t, float or double as in the shader
+ * @param shaderStage
+ * @param constantID
+ * @param value
+ */
+template <typename T>
+inline void set_specialization_constant(ShaderStageDesc &shaderStage, uint32_t constantID, T value)
+{
+    static_assert(std::is_same_v<T, bool> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> ||
+                      std::is_same_v<T, float> || std::is_same_v<T, double>,
+                  "Specialization constants are bool, int, uint, float or double");
+
+    // shader booleans are 32 bits
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        set_specialization_constant(shaderStage, constantID, static_cast<uint32_t>(value ? VK_TRUE : VK_FALSE));
+    }
+    else
+    {
+        auto entry = std::lower_bound(
+            shaderStage.specializationEntries.begin(), shaderStage.specializationEntries.end(), constantID,
+            [](const VkSpecializationMapEntry &entry, uint32_t constantID) { return entry.constantID < constantID; });
+        if (entry != shaderStage.specializationEntries.end() && entry->constantID == constantID &&
+            entry->size == sizeof(T))
+        {
+            memcpy(shaderStage.specializationData.data() + entry->offset, &value, sizeof(T));
+            return;
+        }
+
+        if (entry != shaderStage.specializationEntries.end() && entry->constantID == constantID)
+            entry = shaderStage.specializationEntries.erase(entry);
+        entry = shaderStage.specializationEntries.insert(entry, VkSpecializationMapEntry{
+                                                                    .constantID = constantID,
+                                                                    .size = sizeof(T),
+                                                                });
+
+        // the data is packed in constant ID order so that descs with the same constants have the same bytes
+        std::vector<char> data;
+        for (VkSpecializationMapEntry &other : shaderStage.specializationEntries)
+        {
+            const char *src = &other == &*entry ? reinterpret_cast<const char *>(&value)
+                                                : shaderStage.specializationData.data() + other.offset;
+            other.offset = static_cast<uint32_t>(data.size());
+            data.insert(data.end(), src, src + other.size);
+        }
+        shaderStage.specializationData = std::move(data);
+    }
+}
+
+/**
+ * @brief every state baked in a graphics pipeline, viewport and scissor are dynamic
+ *
+ */
+struct PipelineDesc
+{
+    std::vector<ShaderStageDesc> shaderStages;
+
+    // vertex input
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkBool32 primitiveRestartEnable = VK_FALSE;
+
+    // rasterizer
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+    float lineWidth = 1.f;
+    VkSampleCountFlagBits rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // depth
+    VkBool32 depthTestEnable = VK_TRUE;
+    VkBool32 depthWriteEnable = VK_TRUE;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+    // color blending, one state per color attachment of the subpass
+    std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments;
+
+    std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+};
+
+/**
+ * @brief set a specialization constant on every stage of the pipeline included in stages
+ *
+ */
+template <typename T>
+inline void set_specialization_constant(PipelineDesc &desc, VkShaderStageFlags stages, uint32_t constantID, T value)
+{
+    for (ShaderStageDesc &shaderStage : desc.shaderStages)
+    {
+        if (shaderStage.stage & stages)
+            set_specialization_constant(shaderStage, constantID, value);
+    }
+}
+
+inline VkPipelineColorBlendAttachmentState get_alpha_blend_attachment_state()
+{
+    return VkPipelineColorBlendAttachmentState{
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+        .colorWriteMask =
+            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+    };
+}
+
+/**
+ * @brief Get the default pipeline desc object : shaders/<shaderName>.vert.spv and .frag.spv, Vertex layout, depth
+ * tested and alpha blended
+ *
+ */
+inline PipelineDesc get_default_pipeline_desc(VkRenderPass renderPass, const std::string &shaderName,
+                                              VkPipelineLayout pipelineLayout)
+{
+    auto attribs = VertexDesc::get_vertex_input_attribute_description();
+    return PipelineDesc{
+        .shaderStages =
+            {
+                {.stage = VK_SHADER_STAGE_VERTEX_BIT, .path = "shaders/" + shaderName + ".vert.spv"},
+                {.stage = VK_SHADER_STAGE_FRAGMENT_BIT, .path = "shaders/" + shaderName + ".frag.spv"},
+            },
+        .vertexBindings = {VertexDesc::get_vertex_input_binding_description()},
+        .vertexAttributes = std::vector<VkVertexInputAttributeDescription>(attribs.begin(), attribs.end()),
+        .colorBlendAttachments = {get_alpha_blend_attachment_state()},
+        .pipelineLayout = pipelineLayout,
+        .renderPass = renderPass,
+    };
+}
+
+/**
+ * @brief read the vertices of the binding 0 with the layout V, the other bindings and their attributes are kept
+ *
+ */
+template <typename V> inline void set_vertex_layout(PipelineDesc &desc)
+{
+    auto binding = std::find_if(desc.vertexBindings.begin(), desc.vertexBindings.end(),
+                                [](const VkVertexInputBindingDescription &b) { return b.binding == 0; });
+    assert(binding != desc.vertexBindings.end() && "the desc has no vertex binding 0");
+    *binding = VertexDesc::get_vertex_input_binding_description<V>();
+
+    // the previous layout may have more attributes than V
+    std::erase_if(desc.vertexAttributes,
+                  [](const VkVertexInputAttributeDescription &attribute) { return attribute.binding == 0; });
+    auto attribs = VertexDesc::get_vertex_input_attribute_description<V>();
+    desc.vertexAttributes.insert(desc.vertexAttributes.begin(), attribs.begin(), attribs.end());
+}
+
+/**
+ * @brief Get the instanced pipeline desc object : the default desc with the Instance attributes in a second binding
+ *
+ */
+inline PipelineDesc get_instanced_pipeline_desc(VkRenderPass renderPass, const std::string &shaderName,
+                                                VkPipelineLayout pipelineLayout)
+{
+    PipelineDesc desc = get_default_pipeline_desc(renderPass, shaderName, pipelineLayout);
+    auto attribs = VertexDesc::get_instance_input_attribute_description();
+    desc.vertexBindings.emplace_back(VertexDesc::get_instance_input_binding_description());
+    desc.vertexAttributes.insert(desc.vertexAttributes.end(), attribs.begin(), attribs.end());
+    return desc;
+}
+
+template <typename T> inline void append_to_key(std::string &key, const T &value)
+{
+    key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+template <typename T> inline void append_to_key(std::string &key, const std::vector<T> &values)
+{
+    append_to_key(key, values.size());
+    key.append(reinterpret_cast<const char *>(values.data()), sizeof(T) * values.size());
+}
+inline void append_to_key(std::string &key, const std::string &value)
+{
+    append_to_key(key, value.size());
+    key.append(value);
+}
+
+/**
+ * @brief serialize every state field by field, the Vulkan structures used have no padding
+ *
+ * Two descs produce the same key if and only if they describe the same pipeline.
+ *
+ */
+inline std::string get_pipeline_desc_key(const PipelineDesc &desc)
+{
+    std::string key;
+    append_to_key(key, desc.shaderStages.size());
+    for (const ShaderStageDesc &shaderStage : desc.shaderStages)
+    {
+        append_to_key(key, shaderStage.stage);
+        append_to_key(key, shaderStage.path);
+        append_to_key(key, shaderStage.entryPoint);
+        append_to_key(key, shaderStage.specializationEntries);
+        append_to_key(key, shaderStage.specializationData);
+    }
+    append_to_key(key, desc.vertexBindings);
+    append_to_key(key, desc.vertexAttributes);
+    append_to_key(key, desc.topology);
+    append_to_key(key, desc.primitiveRestartEnable);
+    append_to_key(key, desc.polygonMode);
+    append_to_key(key, desc.cullMode);
+    append_to_key(key, desc.frontFace);
+    append_to_key(key, desc.lineWidth);
+    append_to_key(key, desc.rasterizationSamples);
+    append_to_key(key, desc.depthTestEnable);
+    append_to_key(key, desc.depthWriteEnable);
+    append_to_key(key, desc.depthCompareOp);
+    append_to_key(key, desc.colorBlendAttachments);
+    append_to_key(key, desc.dynamicStates);
+    append_to_key(key, desc.pipelineLayout);
+    append_to_key(key, desc.renderPass);
+    append_to_key(key, desc.subpass);
+    return key;
+}
+/**
+ * @brief FNV-1a of the key, stable for a given desc within the process (handles are hashed by value)
+ *
+ */
+inline uint64_t hash_pipeline_desc_key(const std::string &key)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : key)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+inline uint64_t hash_pipeline_desc(const PipelineDesc &desc)
+{
+    return hash_pipeline_desc_key(get_pipeline_desc_key(desc));
+}
+
+inline bool operator==(const PipelineDesc &a, const PipelineDesc &b)
+{
+    return get_pipeline_desc_key(a) == get_pipeline_desc_key(b);
+}
+} // namespace Pipeline
+} // namespace RHI
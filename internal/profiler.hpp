@@ -0,0 +1,633 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <volk.h>
+
+// CPU scopes, GPU timestamps, per scope statistics and Chrome trace export
+namespace Profiler
+{
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief complete event of the trace, in microseconds since the creation of the session
+ *
+ */
+struct Event
+{
+    std::string name;
+    // 0 for the CPU, 1 for the GPU
+    uint32_t processID;
+    uint32_t threadID;
+    double begin;
+    double duration;
+};
+
+/**
+ * @brief durations of the last frames in milliseconds, one sample per occurrence
+ *
+ */
+struct Samples
+{
+    std::vector<double> values;
+    size_t next = 0;
+};
+
+struct Stats
+{
+    uint32_t count = 0;
+    double min = 0.0;
+    double avg = 0.0;
+    double p99 = 0.0;
+};
+
+/**
+ * @brief timestamps written by the command buffer of a frame in flight, two queries per scope
+ *
+ */
+struct GpuFrame
+{
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    std::vector<std::string> scopeNames;
+    // CPU time of the recording, the GPU events of the frame are placed from it on the trace
+    double recordTime = 0.0;
+    bool bPending = false;
+};
+
+/**
+ * @brief handle of an open CPU scope
+ *
+ */
+struct CpuScope
+{
+    const char *name;
+    Clock::time_point begin;
+};
+
+struct Session
+{
+    Clock::time_point origin;
+
+    // scopes are also opened by the job threads
+    std::mutex mutex;
+    std::map<std::thread::id, uint32_t> threadIDs;
+    std::vector<Event> events;
+    // the trace stops recording once full, the statistics keep being updated
+    size_t maxEventCount;
+    std::map<std::string, Samples> cpuSamples;
+    std::map<std::string, Samples> gpuSamples;
+    size_t maxSampleCount;
+
+    std::optional<Clock::time_point> frameBegin;
+
+    VkDevice device = VK_NULL_HANDLE;
+    // nanoseconds per timestamp tick
+    float timestampPeriod = 0.f;
+    uint64_t timestampMask = 0;
+    uint32_t maxGpuScopeCount;
+    // one query pool per frame in flight, empty if the queue does not support timestamps
+    std::vector<GpuFrame> gpuFrames;
+    GpuFrame *recordingGpuFrame = nullptr;
+};
+
+inline double get_time(const Session &session, Clock::time_point time)
+{
+    return std::chrono::duration<double, std::micro>(time - session.origin).count();
+}
+
+inline void add_sample(std::map<std::string, Samples> &samples, const std::string &name, double value,
+                       size_t maxSampleCount)
+{
+    Samples &scopeSamples = samples[name];
+    if (scopeSamples.values.size() < maxSampleCount)
+    {
+        scopeSamples.values.emplace_back(value);
+        return;
+    }
+    scopeSamples.values[scopeSamples.next] = value;
+    scopeSamples.next = (scopeSamples.next + 1) % maxSampleCount;
+}
+
+/**
+ * @brief Create a session object
+ *
+ * @param device
+ * @param physicalDevice
+ * @param queueFamilyIndex family of the queue running the command buffers with GPU scopes
+ * @param frameInFlightCount
+ * @param maxGpuScopeCount GPU scopes per frame, the next ones are ignored
+ * @param maxSampleCount frames the statistics are computed over
+ * @param maxEventCount events kept for the trace
+ * @return std::unique_ptr<Session>
+ */
+inline std::unique_ptr<Session> create_session(VkDevice device, VkPhysicalDevice physicalDevice,
+                                               uint32_t queueFamilyIndex, uint32_t frameInFlightCount,
+                                               uint32_t maxGpuScopeCount = 32, size_t maxSampleCount = 1000,
+                                               size_t maxEventCount = 1 << 20)
+{
+    auto session = std::make_unique<Session>();
+    session->origin = Clock::now();
+    session->maxEventCount = maxEventCount;
+    session->maxSampleCount = maxSampleCount;
+    session->device = device;
+    session->maxGpuScopeCount = maxGpuScopeCount;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    session->timestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+    if (validBits == 0)
+    {
+        std::cerr << "Timestamps are not supported by the queue family, GPU scopes are disabled" << std::endl;
+        return session;
+    }
+    session->timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = maxGpuScopeCount * 2,
+    };
+    session->gpuFrames.resize(frameInFlightCount);
+    for (GpuFrame &gpuFrame : session->gpuFrames)
+    {
+        VkResult res = vkCreateQueryPool(device, &createInfo, nullptr, &gpuFrame.queryPool);
+        if (res != VK_SUCCESS)
+            std::cerr << "Failed to create query pool : " << res << std::endl;
+    }
+
+    return session;
+}
+/**
+ * @brief the frames in flight must be complete
+ *
+ */
+inline void destroy_session(std::unique_ptr<Session> &session)
+{
+    for (GpuFrame &gpuFrame : session->gpuFrames)
+        vkDestroyQueryPool(session->device, gpuFrame.queryPool, nullptr);
+    session.reset();
+}
+
+/**
+ * @brief small identifiers in order of appearance so that the trace shows the main thread first
+ *
+ */
+inline uint32_t get_thread_id(Session &session)
+{
+    auto threadID = session.threadIDs.try_emplace(std::this_thread::get_id(),
+                                                  static_cast<uint32_t>(session.threadIDs.size()));
+    return threadID.first->second;
+}
+
+inline void add_event(Session &session, Event event)
+{
+    if (session.events.size() < session.maxEventCount)
+        session.events.emplace_back(std::move(event));
+}
+
+/**
+ * @brief to call at the beginning of every frame, measures the time between two calls
+ *
+ */
+inline void begin_frame(Session &session)
+{
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(session.mutex);
+    if (session.frameBegin.has_value())
+    {
+        double duration = get_time(session, now) - get_time(session, session.frameBegin.value());
+        add_event(session, Event{.name = "frame",
+                                 .processID = 0,
+                                 .threadID = get_thread_id(session),
+                                 .begin = get_time(session, session.frameBegin.value()),
+                                 .duration = duration});
+        add_sample(session.cpuSamples, "frame", duration / 1000.0, session.maxSampleCount);
+    }
+    session.frameBegin = now;
+}
+
+/**
+ * @brief open a CPU scope, thread safe
+ *
+ * @param name string literal, kept until the scope is closed
+ */
+inline CpuScope begin_cpu_scope(const char *name)
+{
+    return CpuScope{.name = name, .begin = Clock::now()};
+}
+inline void end_cpu_scope(Session &session, const CpuScope &scope)
+{
+    Clock::time_point end = Clock::now();
+    std::lock_guard<std::mutex> lock(session.mutex);
+    double begin = get_time(session, scope.begin);
+    double duration = get_time(session, end) - begin;
+    add_event(session, Event{.name = scope.name,
+                             .processID = 0,
+                             .threadID = get_thread_id(session),
+                             .begin = begin,
+                             .duration = duration});
+    add_sample(session.cpuSamples, scope.name, duration / 1000.0, session.maxSampleCount);
+}
+
+/**
+ * @brief read the timestamps of the previous use of the frame and reset its queries
+ *
+ * To record outside of a render pass, once the fence of the frame has been waited on.
+ *
+ * @param session
+ * @param commandBuffer primary command buffer of the frame, begun
+ * @param frameInFlightIndex
+ */
+inline void begin_gpu_frame(Session &session, VkCommandBuffer commandBuffer, uint32_t frameInFlightIndex)
+{
+    if (session.gpuFrames.empty())
+        return;
+
+    GpuFrame &gpuFrame = session.gpuFrames[frameInFlightIndex];
+    uint32_t queryCount = static_cast<uint32_t>(gpuFrame.scopeNames.size()) * 2;
+    if (gpuFrame.bPending && queryCount > 0)
+    {
+        std::vector<uint64_t> timestamps(queryCount);
+        VkResult res = vkGetQueryPoolResults(session.device, gpuFrame.queryPool, 0, queryCount,
+                                             timestamps.size() * sizeof(uint64_t), timestamps.data(),
+                                             sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (res == VK_SUCCESS)
+        {
+            std::lock_guard<std::mutex> lock(session.mutex);
+            uint64_t frameBegin = timestamps[0] & session.timestampMask;
+            for (size_t i = 0; i < gpuFrame.scopeNames.size(); ++i)
+            {
+                uint64_t begin = timestamps[i * 2] & session.timestampMask;
+                uint64_t end = timestamps[i * 2 + 1] & session.timestampMask;
+                // ticks wrap around with less than 64 valid bits
+                double duration = ((end - begin) & session.timestampMask) * session.timestampPeriod / 1000.0;
+                double offset = ((begin - frameBegin) & session.timestampMask) * session.timestampPeriod / 1000.0;
+                add_event(session, Event{.name = gpuFrame.scopeNames[i],
+                                         .processID = 1,
+                                         .threadID = 0,
+                                         .begin = gpuFrame.recordTime + offset,
+                                         .duration = duration});
+                add_sample(session.gpuSamples, gpuFrame.scopeNames[i], duration / 1000.0, session.maxSampleCount);
+            }
+        }
+        else if (res != VK_NOT_READY)
+        {
+            std::cerr << "Failed to get timestamp query results : " << res << std::endl;
+        }
+    }
+
+    vkCmdResetQueryPool(commandBuffer, gpuFrame.queryPool, 0, session.maxGpuScopeCount * 2);
+    gpuFrame.scopeNames.clear();
+    gpuFrame.recordTime = get_time(session, Clock::now());
+    gpuFrame.bPending = true;
+    session.recordingGpuFrame = &gpuFrame;
+}
+
+/**
+ * @brief write the timestamp opening a GPU scope, nested scopes are supported
+ *
+ * @return uint32_t scope index to close, ~0u if the scope is ignored
+ */
+inline uint32_t begin_gpu_scope(Session &session, VkCommandBuffer commandBuffer, const std::string &name)
+{
+    GpuFrame *gpuFrame = session.recordingGpuFrame;
+    if (!gpuFrame || gpuFrame->scopeNames.size() >= session.maxGpuScopeCount)
+        return ~0u;
+
+    uint32_t scope = static_cast<uint32_t>(gpuFrame->scopeNames.size());
+    gpuFrame->scopeNames.emplace_back(name);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpuFrame->queryPool, scope * 2);
+    return scope;
+}
+inline void end_gpu_scope(Session &session, VkCommandBuffer commandBuffer, uint32_t scope)
+{
+    GpuFrame *gpuFrame = session.recordingGpuFrame;
+    if (!gpuFrame || scope == ~0u)
+        return;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, gpuFrame->queryPool, scope * 2 + 1);
+}
+
+inline Stats compute_stats(const Samples &samples)
+{
+    Stats stats;
+    if (samples.values.empty())
+        return stats;
+
+    std::vector<double> sorted = samples.values;
+    std::sort(sorted.begin(), sorted.end());
+    stats.count = static_cast<uint32_t>(sorted.size());
+    stats.min = sorted.front();
+    for (double value : sorted)
+        stats.avg += value;
+    stats.avg /= sorted.size();
+    stats.p99 = sorted[(std::min)(sorted.size() - 1, sorted.size() * 99 / 100)];
+    return stats;
+}
+
+/**
+ * @brief min, average and 99th percentile in milliseconds of every scope over the last frames
+ *
+ */
+inline void print_stats(Session &session)
+{
+    std::lock_guard<std::mutex> lock(session.mutex);
+    auto print = [](const char *category, const std::map<std::string, Samples> &samples) {
+        for (const auto &[name, scopeSamples] : samples)
+        {
+            Stats stats = compute_stats(scopeSamples);
+            std::cout << category << "\t" << name << "\tmin " << stats.min << " ms\tavg " << stats.avg
+                      << " ms\tp99 " << stats.p99 << " ms\t(" << stats.count << " samples)\n";
+        }
+    };
+    print("cpu", session.cpuSamples);
+    print("gpu", session.gpuSamples);
+    std::cout.flush();
+}
+
+/**
+ * @brief write the events in the Trace Event Format, to open in chrome://tracing or Perfetto
+ *
+ * @return bool false if the file could not be written
+ */
+inline bool export_chrome_trace(Session &session, const std::string &filename)
+{
+    std::ofstream file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open file : " << filename << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(session.mutex);
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}";
+    file.precision(3);
+    file << std::fixed;
+    for (const Event &event : session.events)
+    {
+        // scope names are identifiers, not escaped
+        file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":" << event.processID
+             << ",\"tid\":" << event.threadID << ",\"ts\":" << event.begin << ",\"dur\":" << event.duration << "}";
+    }
+    file << "\n]}\n";
+    return file.good();
+}
+
+/**
+ * @brief counters of a named pass summed over the frames read back
+ *
+ */
+struct PassStatistics
+{
+    uint64_t inputAssemblyVertices = 0;
+    uint64_t inputAssemblyPrimitives = 0;
+    uint64_t vertexShaderInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentShaderInvocations = 0;
+    // samples passing the depth test, one per pixel covered per draw
+    uint64_t samplesPassed = 0;
+    uint64_t frameCount = 0;
+};
+
+// read back in this order, the order of the bits
+constexpr VkQueryPipelineStatisticFlags pipelineStatisticFlags =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+constexpr uint32_t pipelineStatisticCount = 6;
+
+/**
+ * @brief queries of a frame in flight, one pipeline statistics and one occlusion query per instrumented draw range
+ *
+ */
+struct StatisticsFrame
+{
+    VkQueryPool statisticsQueryPool = VK_NULL_HANDLE;
+    VkQueryPool occlusionQueryPool = VK_NULL_HANDLE;
+    // pass of each query
+    std::vector<std::string> passNames;
+    bool bPending = false;
+};
+
+struct StatisticsSession
+{
+    VkDevice device;
+    VkQueryControlFlags occlusionControlFlags = 0;
+    uint32_t maxRangeCount;
+
+    // draw ranges are also instrumented by the job threads
+    std::mutex mutex;
+    std::vector<StatisticsFrame> frames;
+    StatisticsFrame *recordingFrame = nullptr;
+
+    std::map<std::string, PassStatistics> passes;
+};
+
+/**
+ * @brief Create a statistics session object, opt-in as the queries slow the draws down
+ *
+ * @param device created with the pipelineStatisticsQuery feature
+ * @param physicalDevice
+ * @param frameInFlightCount
+ * @param maxRangeCount instrumented draw ranges per frame, the next ones are not instrumented
+ * @return std::unique_ptr<StatisticsSession> nullptr if pipeline statistics are not supported
+ */
+inline std::unique_ptr<StatisticsSession> create_statistics_session(VkDevice device, VkPhysicalDevice physicalDevice,
+                                                                   uint32_t frameInFlightCount,
+                                                                   uint32_t maxRangeCount = 256)
+{
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    if (!supportedFeatures.pipelineStatisticsQuery)
+    {
+        std::cerr << "Pipeline statistics queries are not supported by the physical device" << std::endl;
+        return nullptr;
+    }
+
+    auto session = std::make_unique<StatisticsSession>();
+    session->device = device;
+    session->maxRangeCount = maxRangeCount;
+    // otherwise the sample counts are only guaranteed to be non-zero when samples pass
+    if (supportedFeatures.occlusionQueryPrecise)
+        session->occlusionControlFlags = VK_QUERY_CONTROL_PRECISE_BIT;
+
+    VkQueryPoolCreateInfo statisticsCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+        .queryCount = maxRangeCount,
+        .pipelineStatistics = pipelineStatisticFlags,
+    };
+    VkQueryPoolCreateInfo occlusionCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_OCCLUSION,
+        .queryCount = maxRangeCount,
+    };
+    session->frames.resize(frameInFlightCount);
+    for (StatisticsFrame &frame : session->frames)
+    {
+        VkResult res = vkCreateQueryPool(device, &statisticsCreateInfo, nullptr, &frame.statisticsQueryPool);
+        if (res != VK_SUCCESS)
+            std::cerr << "Failed to create query pool : " << res << std::endl;
+        res = vkCreateQueryPool(device, &occlusionCreateInfo, nullptr, &frame.occlusionQueryPool);
+        if (res != VK_SUCCESS)
+            std::cerr << "Failed to create query pool : " << res << std::endl;
+    }
+
+    return session;
+}
+/**
+ * @brief the frames in flight must be complete
+ *
+ */
+inline void destroy_statistics_session(std::unique_ptr<StatisticsSession> &session)
+{
+    for (StatisticsFrame &frame : session->frames)
+    {
+        vkDestroyQueryPool(session->device, frame.statisticsQueryPool, nullptr);
+        vkDestroyQueryPool(session->device, frame.occlusionQueryPool, nullptr);
+    }
+    session.reset();
+}
+
+/**
+ * @brief accumulate the results of the previous use of the frame and reset its queries
+ *
+ * To record outside of a render pass, once the fence of the frame has been waited on. The results of a frame that are
+ * not available yet are skipped rather than waited for.
+ *
+ * @param session
+ * @param commandBuffer primary command buffer of the frame, begun
+ * @param frameInFlightIndex
+ */
+inline void begin_statistics_frame(StatisticsSession &session, VkCommandBuffer commandBuffer,
+                                   uint32_t frameInFlightIndex)
+{
+    StatisticsFrame &frame = session.frames[frameInFlightIndex];
+    uint32_t queryCount = static_cast<uint32_t>(frame.passNames.size());
+    if (frame.bPending && queryCount > 0)
+    {
+        std::vector<uint64_t> statistics(queryCount * pipelineStatisticCount);
+        std::vector<uint64_t> samplesPassed(queryCount);
+        VkResult statisticsRes = vkGetQueryPoolResults(
+            session.device, frame.statisticsQueryPool, 0, queryCount, statistics.size() * sizeof(uint64_t),
+            statistics.data(), pipelineStatisticCount * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        VkResult occlusionRes = vkGetQueryPoolResults(session.device, frame.occlusionQueryPool, 0, queryCount,
+                                                      samplesPassed.size() * sizeof(uint64_t), samplesPassed.data(),
+                                                      sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (statisticsRes == VK_SUCCESS && occlusionRes == VK_SUCCESS)
+        {
+            std::set<std::string> framePasses;
+            for (uint32_t i = 0; i < queryCount; ++i)
+            {
+                PassStatistics &pass = session.passes[frame.passNames[i]];
+                const uint64_t *values = statistics.data() + i * pipelineStatisticCount;
+                pass.inputAssemblyVertices += values[0];
+                pass.inputAssemblyPrimitives += values[1];
+                pass.vertexShaderInvocations += values[2];
+                pass.clippingInvocations += values[3];
+                pass.clippingPrimitives += values[4];
+                pass.fragmentShaderInvocations += values[5];
+                pass.samplesPassed += samplesPassed[i];
+                // a pass can be made of several draw ranges
+                if (framePasses.insert(frame.passNames[i]).second)
+                    ++pass.frameCount;
+            }
+        }
+        else if (statisticsRes != VK_NOT_READY || occlusionRes != VK_NOT_READY)
+        {
+            std::cerr << "Failed to get pipeline statistics query results : " << statisticsRes << ", " << occlusionRes
+                      << std::endl;
+        }
+    }
+
+    vkCmdResetQueryPool(commandBuffer, frame.statisticsQueryPool, 0, session.maxRangeCount);
+    vkCmdResetQueryPool(commandBuffer, frame.occlusionQueryPool, 0, session.maxRangeCount);
+    frame.passNames.clear();
+    frame.bPending = true;
+    session.recordingFrame = &frame;
+}
+
+/**
+ * @brief begin counting the draws recorded in the command buffer until end_pass_statistics, thread safe
+ *
+ * Secondary command buffers begin and end their own queries, the queries of the primary are not inherited.
+ *
+ * @param session
+ * @param commandBuffer inside a render pass
+ * @param passName draw ranges of the same pass are summed
+ * @return uint32_t query to end, ~0u if the draw range is not instrumented
+ */
+inline uint32_t begin_pass_statistics(StatisticsSession &session, VkCommandBuffer commandBuffer,
+                                      const std::string &passName)
+{
+    uint32_t query;
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        StatisticsFrame *frame = session.recordingFrame;
+        if (!frame || frame->passNames.size() >= session.maxRangeCount)
+            return ~0u;
+        query = static_cast<uint32_t>(frame->passNames.size());
+        frame->passNames.emplace_back(passName);
+    }
+
+    vkCmdBeginQuery(commandBuffer, session.recordingFrame->statisticsQueryPool, query, 0);
+    vkCmdBeginQuery(commandBuffer, session.recordingFrame->occlusionQueryPool, query, session.occlusionControlFlags);
+    return query;
+}
+inline void end_pass_statistics(StatisticsSession &session, VkCommandBuffer commandBuffer, uint32_t query)
+{
+    if (query == ~0u)
+        return;
+
+    vkCmdEndQuery(commandBuffer, session.recordingFrame->occlusionQueryPool, query);
+    vkCmdEndQuery(commandBuffer, session.recordingFrame->statisticsQueryPool, query);
+}
+
+/**
+ * @brief per frame averages of every pass
+ *
+ * @param session
+ * @param pixelCount of the render target, to estimate the overdraw as the fragments shaded per pixel
+ */
+inline void print_statistics_report(const StatisticsSession &session, uint64_t pixelCount)
+{
+    for (const auto &[name, pass] : session.passes)
+    {
+        if (pass.frameCount == 0)
+            continue;
+
+        double frameCount = static_cast<double>(pass.frameCount);
+        std::cout << "pass " << name << " (" << pass.frameCount << " frames)\n"
+                  << "\tinput assembly : " << pass.inputAssemblyVertices / frameCount << " vertices, "
+                  << pass.inputAssemblyPrimitives / frameCount << " primitives\n"
+                  << "\tvertex shader invocations : " << pass.vertexShaderInvocations / frameCount << '\n'
+                  << "\tclipping : " << pass.clippingInvocations / frameCount << " primitives in, "
+                  << pass.clippingPrimitives / frameCount << " out\n"
+                  << "\tfragment shader invocations : " << pass.fragmentShaderInvocations / frameCount << '\n'
+                  << "\tsamples passed : " << pass.samplesPassed / frameCount << '\n'
+                  << "\toverdraw : " << pass.fragmentShaderInvocations / frameCount / pixelCount << '\n';
+    }
+    std::cout.flush();
+}
+} // namespace Profiler
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <shaderc/shaderc.hpp>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "utils.hpp"
+
+// Runtime GLSL to SPIR-V compilation with hot reload
+namespace ShaderCompiler
+{
+/**
+ * @brief compiles the GLSL sources of a directory to SPIR-V and recompiles them when they change
+ *
+ * SPIR-V files are written to the output directory as <source name>.spv, the path create_pipeline loads.
+ *
+ */
+struct Service
+{
+    std::filesystem::path sourceDir;
+    std::filesystem::path outputDir;
+    // SPIR-V of every source compiled so far, named after the hash of the source
+    std::filesystem::path cacheDir;
+
+    shaderc::Compiler compiler;
+    shaderc::CompileOptions options;
+    // the options set, part of the cache key
+    std::string optionsKey;
+
+    std::thread watcher;
+    std::atomic<bool> bRunning = true;
+#ifdef __linux__
+    int inotifyFd = -1;
+#else
+    std::map<std::filesystem::path, std::filesystem::file_time_type> writeTimes;
+#endif
+
+    // SPIR-V files rebuilt by the watcher and not yet taken by the frame loop
+    std::mutex mutex;
+    std::vector<std::string> reloadedPaths;
+};
+
+inline std::optional<shaderc_shader_kind> get_shader_kind(const std::filesystem::path &sourcePath)
+{
+    std::string extension = sourcePath.extension().string();
+    if (extension == ".vert")
+        return shaderc_vertex_shader;
+    if (extension == ".frag")
+        return shaderc_fragment_shader;
+    if (extension == ".comp")
+        return shaderc_compute_shader;
+    return std::nullopt;
+}
+
+inline bool read_text_file(const std::filesystem::path &path, std::string &text)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    text = stream.str();
+    return true;
+}
+
+/**
+ * @brief resolves #include "file" relative to the including file
+ *
+ */
+class Includer : public shaderc::CompileOptions::IncluderInterface
+{
+    struct Include
+    {
+        std::string name;
+        std::string content;
+        shaderc_include_result result;
+    };
+
+  public:
+    shaderc_include_result *GetInclude(const char *requestedSource, shaderc_include_type type,
+                                       const char *requestingSource, size_t includeDepth) override
+    {
+        auto include = new Include();
+        std::filesystem::path path = std::filesystem::path(requestingSource).parent_path() / requestedSource;
+        if (read_text_file(path, include->content))
+            include->name = path.string();
+        else
+            include->content = "Failed to open file : " + path.string();
+
+        // an empty name reports the content as the error
+        include->result = shaderc_include_result{
+            .source_name = include->name.c_str(),
+            .source_name_length = include->name.size(),
+            .content = include->content.c_str(),
+            .content_length = include->content.size(),
+            .user_data = include,
+        };
+        return &include->result;
+    }
+    void ReleaseInclude(shaderc_include_result *data) override
+    {
+        delete static_cast<Include *>(data->user_data);
+    }
+};
+
+/**
+ * @brief append the content of every file #include'd by source, recursively, so that editing an included file
+ * changes the cache key of its includers
+ *
+ */
+inline void append_includes(const std::filesystem::path &sourcePath, const std::string &source, std::string &key,
+                            uint32_t depth = 0)
+{
+    // same limit as glslang
+    if (depth > 32)
+        return;
+
+    std::istringstream lines(source);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        size_t directive = line.find("#include");
+        size_t begin = line.find('"', directive);
+        size_t end = begin != std::string::npos ? line.find('"', begin + 1) : std::string::npos;
+        if (directive == std::string::npos || end == std::string::npos)
+            continue;
+
+        std::filesystem::path includePath = sourcePath.parent_path() / line.substr(begin + 1, end - begin - 1);
+        std::string include;
+        if (!read_text_file(includePath, include))
+            continue;
+        key.append(include);
+        append_includes(includePath, include, key, depth + 1);
+    }
+}
+
+/**
+ * @brief FNV-1a of the source, its stage, the compile options and the content of its #include'd files
+ *
+ */
+inline uint64_t hash_source(const Service &service, const std::filesystem::path &sourcePath,
+                            const std::string &source, shaderc_shader_kind kind)
+{
+    std::string key = service.optionsKey + source;
+    append_includes(sourcePath, source, key);
+
+    uint64_t hash = 14695981039346656037ull ^ static_cast<uint64_t>(kind);
+    for (char c : key)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline std::filesystem::path get_output_path(const Service &service, const std::filesystem::path &sourcePath)
+{
+    return service.outputDir / (sourcePath.filename().string() + ".spv");
+}
+
+/**
+ * @brief compile a source to its output SPIR-V file, unless the SPIR-V of the same source is in the cache
+ *
+ * The files are replaced by renaming so that the shader modules being loaded never read a partial file.
+ *
+ * @param service
+ * @param sourcePath
+ * @param pbChanged set to whether the output SPIR-V file changed
+ * @return bool false if the source could not be read or compiled, the previous SPIR-V file is kept
+ */
+inline bool compile_source(Service &service, const std::filesystem::path &sourcePath, bool *pbChanged = nullptr)
+{
+    if (pbChanged)
+        *pbChanged = false;
+    std::optional<shaderc_shader_kind> kind = get_shader_kind(sourcePath);
+    if (!kind.has_value())
+        return false;
+
+    std::string source;
+    if (!read_text_file(sourcePath, source))
+    {
+        std::cerr << "Failed to open file : " << sourcePath << std::endl;
+        return false;
+    }
+
+    std::ostringstream cacheName;
+    cacheName << std::hex << hash_source(service, sourcePath, source, kind.value()) << ".spv";
+    std::filesystem::path cachePath = service.cacheDir / cacheName.str();
+
+    std::vector<char> spirv;
+    if (!std::filesystem::exists(cachePath) || !read_binary_file(cachePath.string(), spirv))
+    {
+        shaderc::SpvCompilationResult result =
+            service.compiler.CompileGlslToSpv(source, kind.value(), sourcePath.string().c_str(), service.options);
+        if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+        {
+            std::cerr << "Failed to compile shader : " << sourcePath << std::endl << result.GetErrorMessage();
+            return false;
+        }
+
+        spirv.assign(reinterpret_cast<const char *>(result.cbegin()), reinterpret_cast<const char *>(result.cend()));
+        replace_binary_file(cachePath.string(), spirv);
+        std::cout << "Compiled shader " << sourcePath.filename().string() << std::endl;
+    }
+
+    std::string outputPath = get_output_path(service, sourcePath).string();
+    std::vector<char> previousSpirv;
+    if (std::filesystem::exists(outputPath) && read_binary_file(outputPath, previousSpirv) && previousSpirv == spirv)
+        return true;
+    if (pbChanged)
+        *pbChanged = true;
+    return replace_binary_file(outputPath, spirv);
+}
+
+inline void notify_reloaded(Service &service, const std::filesystem::path &sourcePath)
+{
+    std::lock_guard<std::mutex> lock(service.mutex);
+    service.reloadedPaths.emplace_back(get_output_path(service, sourcePath).generic_string());
+}
+
+/**
+ * @brief a stage is compiled again on its own, any other file may be included by every stage
+ *
+ */
+inline void on_source_changed(Service &service, const std::filesystem::path &changedPath)
+{
+    std::vector<std::filesystem::path> sourcePaths;
+    if (get_shader_kind(changedPath).has_value())
+    {
+        sourcePaths.emplace_back(changedPath);
+    }
+    else
+    {
+        std::error_code error;
+        for (const auto &entry : std::filesystem::directory_iterator(service.sourceDir, error))
+        {
+            if (get_shader_kind(entry.path()).has_value())
+                sourcePaths.emplace_back(entry.path());
+        }
+    }
+
+    for (const std::filesystem::path &sourcePath : sourcePaths)
+    {
+        bool bChanged;
+        if (compile_source(service, sourcePath, &bChanged) && bChanged)
+            notify_reloaded(service, sourcePath);
+    }
+}
+
+inline void watch_sources(Service &service)
+{
+#ifdef __linux__
+    // editors either rewrite the file or replace it with a renamed one
+    inotify_add_watch(service.inotifyFd, service.sourceDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+    alignas(inotify_event) char events[4096];
+    while (service.bRunning)
+    {
+        pollfd pollFd = {.fd = service.inotifyFd, .events = POLLIN};
+        if (poll(&pollFd, 1, 100) <= 0)
+            continue;
+
+        ssize_t size = read(service.inotifyFd, events, sizeof(events));
+        for (ssize_t offset = 0; offset < size;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(events + offset);
+            offset += sizeof(inotify_event) + event->len;
+            if (event->len == 0)
+                continue;
+
+            on_source_changed(service, service.sourceDir / event->name);
+        }
+    }
+#else
+    // no change notification used on this platform, the write times are polled
+    while (service.bRunning)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+        std::error_code error;
+        for (const auto &entry : std::filesystem::directory_iterator(service.sourceDir, error))
+        {
+            std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+            auto [previousWriteTime, bInserted] = service.writeTimes.try_emplace(entry.path(), writeTime);
+            if (bInserted || previousWriteTime->second == writeTime)
+                continue;
+
+            previousWriteTime->second = writeTime;
+            on_source_changed(service, entry.path());
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Create a service object, compiles every source of the directory before returning
+ *
+ * @param sourceDir directory of the .vert, .frag and .comp sources
+ * @param outputDir directory create_pipeline loads the SPIR-V files from
+ * @param cacheDir on-disk SPIR-V cache so that unchanged sources are not compiled again on startup
+ * @param bWatch recompile the sources when they change
+ * @return std::unique_ptr<Service>
+ */
+inline std::unique_ptr<Service> create_service(const std::filesystem::path &sourceDir,
+                                               const std::filesystem::path &outputDir,
+                                               const std::filesystem::path &cacheDir, bool bWatch = true)
+{
+    auto service = std::make_unique<Service>();
+    service->sourceDir = sourceDir;
+    service->outputDir = outputDir;
+    service->cacheDir = cacheDir;
+    shaderc_optimization_level optimizationLevel = shaderc_optimization_level_performance;
+    shaderc_env_version targetVersion = shaderc_env_version_vulkan_1_3;
+    service->options.SetOptimizationLevel(optimizationLevel);
+    service->options.SetTargetEnvironment(shaderc_target_env_vulkan, targetVersion);
+    service->options.SetIncluder(std::make_unique<Includer>());
+    service->optionsKey = "O" + std::to_string(optimizationLevel) + " vulkan" + std::to_string(targetVersion) + " ";
+
+    std::error_code error;
+    std::filesystem::create_directories(outputDir, error);
+    std::filesystem::create_directories(cacheDir, error);
+
+    for (const auto &entry : std::filesystem::directory_iterator(sourceDir, error))
+    {
+        compile_source(*service, entry.path());
+#ifndef __linux__
+        service->writeTimes[entry.path()] = entry.last_write_time(error);
+#endif
+    }
+    if (error)
+        std::cerr << "Failed to list shader sources : " << sourceDir << std::endl;
+
+    if (bWatch)
+    {
+#ifdef __linux__
+        service->inotifyFd = inotify_init1(IN_NONBLOCK);
+        if (service->inotifyFd < 0)
+        {
+            std::cerr << "Failed to watch shader sources : " << sourceDir << std::endl;
+            return service;
+        }
+#endif
+        service->watcher = std::thread(watch_sources, std::ref(*service));
+    }
+
+    return service;
+}
+inline void destroy_service(std::unique_ptr<Service> &service)
+{
+    service->bRunning = false;
+    if (service->watcher.joinable())
+        service->watcher.join();
+#ifdef __linux__
+    if (service->inotifyFd >= 0)
+        close(service->inotifyFd);
+#endif
+    service.reset();
+}
+
+/**
+ * @brief to call at a frame boundary
+ *
+ * @return std::vector<std::string> paths of the SPIR-V files rebuilt since the last call
+ */
+inline std::vector<std::string> take_reloaded_paths(Service &service)
+{
+    std::vector<std::string> reloadedPaths;
+    std::lock_guard<std::mutex> lock(service.mutex);
+    reloadedPaths.swap(service.reloadedPaths);
+    return reloadedPaths;
+}
+} // namespace ShaderCompiler
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// storage buffers and images, read and written by the compute shaders (or any other stage)
+namespace StorageDesc
+{
+inline VkDescriptorSetLayoutBinding get_storage_buffer_layout_binding(uint32_t binding, VkShaderStageFlags stageFlags,
+                                                                      uint32_t descriptorCount = 1)
+{
+    return VkDescriptorSetLayoutBinding{
+        .binding = binding,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = descriptorCount,
+        .stageFlags = stageFlags,
+        .pImmutableSamplers = nullptr,
+    };
+}
+/**
+ * @brief the image must be in VK_IMAGE_LAYOUT_GENERAL when accessed
+ *
+ */
+inline VkDescriptorSetLayoutBinding get_storage_image_layout_binding(uint32_t binding, VkShaderStageFlags stageFlags,
+                                                                     uint32_t descriptorCount = 1)
+{
+    return VkDescriptorSetLayoutBinding{
+        .binding = binding,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        .descriptorCount = descriptorCount,
+        .stageFlags = stageFlags,
+        .pImmutableSamplers = nullptr,
+    };
+}
+
+/**
+ * @brief pool sizes for setCount sets of bufferCount storage buffers and imageCount storage images
+ *
+ */
+inline std::vector<VkDescriptorPoolSize> get_storage_descriptor_pool_sizes(uint32_t setCount, uint32_t bufferCount,
+                                                                           uint32_t imageCount = 0)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    if (bufferCount > 0)
+    {
+        poolSizes.emplace_back(VkDescriptorPoolSize{
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = setCount * bufferCount,
+        });
+    }
+    if (imageCount > 0)
+    {
+        poolSizes.emplace_back(VkDescriptorPoolSize{
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = setCount * imageCount,
+        });
+    }
+    return poolSizes;
+}
+
+/**
+ * @brief bufferInfo must outlive the write
+ *
+ */
+inline VkWriteDescriptorSet get_storage_buffer_descriptor_set_write(VkDescriptorSet descriptorSet, uint32_t binding,
+                                                                    const VkDescriptorBufferInfo &bufferInfo)
+{
+    return VkWriteDescriptorSet{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = descriptorSet,
+        .dstBinding = binding,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = &bufferInfo,
+        .pTexelBufferView = nullptr,
+    };
+}
+/**
+ * @brief imageInfo must outlive the write, no sampler is used
+ *
+ */
+inline VkWriteDescriptorSet get_storage_image_descriptor_set_write(VkDescriptorSet descriptorSet, uint32_t binding,
+                                                                   const VkDescriptorImageInfo &imageInfo)
+{
+    return VkWriteDescriptorSet{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = descriptorSet,
+        .dstBinding = binding,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        .pImageInfo = &imageInfo,
+        .pTexelBufferView = nullptr,
+    };
+}
+} // namespace StorageDesc
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORMS_SSE
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TRANSFORMS_AVX2
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Object transforms stored as structure of arrays, composed in batches straight into mapped GPU memory
+namespace Transforms
+{
+/**
+ * @brief a stream per component so that a SIMD register holds the same component of consecutive objects
+ *
+ */
+struct Store
+{
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+    // unit quaternions
+    std::vector<float> rotationX;
+    std::vector<float> rotationY;
+    std::vector<float> rotationZ;
+    std::vector<float> rotationW;
+    std::vector<float> scaleX;
+    std::vector<float> scaleY;
+    std::vector<float> scaleZ;
+};
+
+inline uint32_t get_count(const Store &store)
+{
+    return static_cast<uint32_t>(store.positionX.size());
+}
+
+inline void reserve(Store &store, uint32_t count)
+{
+    for (std::vector<float> *stream :
+         {&store.positionX, &store.positionY, &store.positionZ, &store.rotationX, &store.rotationY, &store.rotationZ,
+          &store.rotationW, &store.scaleX, &store.scaleY, &store.scaleZ})
+        stream->reserve(count);
+}
+
+inline void set_transform(Store &store, uint32_t index, const glm::vec3 &position, const glm::quat &rotation,
+                          const glm::vec3 &scale)
+{
+    store.positionX[index] = position.x;
+    store.positionY[index] = position.y;
+    store.positionZ[index] = position.z;
+    store.rotationX[index] = rotation.x;
+    store.rotationY[index] = rotation.y;
+    store.rotationZ[index] = rotation.z;
+    store.rotationW[index] = rotation.w;
+    store.scaleX[index] = scale.x;
+    store.scaleY[index] = scale.y;
+    store.scaleZ[index] = scale.z;
+}
+/**
+ * @return uint32_t index of the transform, also the index of its matrix once written
+ */
+inline uint32_t add_transform(Store &store, const glm::vec3 &position, const glm::quat &rotation,
+                              const glm::vec3 &scale = glm::vec3(1.f))
+{
+    uint32_t index = get_count(store);
+    for (std::vector<float> *stream :
+         {&store.positionX, &store.positionY, &store.positionZ, &store.rotationX, &store.rotationY, &store.rotationZ,
+          &store.rotationW, &store.scaleX, &store.scaleY, &store.scaleZ})
+        stream->emplace_back(0.f);
+    set_transform(store, index, position, rotation, scale);
+    return index;
+}
+
+enum class Kernel
+{
+    Scalar,
+    SSE,
+    AVX2,
+};
+
+/**
+ * @brief the SIMD kernels are only available if the instruction set is enabled at compile time
+ *
+ */
+inline bool is_kernel_supported(Kernel kernel)
+{
+    switch (kernel)
+    {
+#ifdef TRANSFORMS_AVX2
+    case Kernel::AVX2:
+        return true;
+#endif
+#ifdef TRANSFORMS_SSE
+    case Kernel::SSE:
+        return true;
+#endif
+    case Kernel::Scalar:
+        return true;
+    default:
+        return false;
+    }
+}
+inline Kernel get_best_kernel()
+{
+#if defined(TRANSFORMS_AVX2)
+    return Kernel::AVX2;
+#elif defined(TRANSFORMS_SSE)
+    return Kernel::SSE;
+#else
+    return Kernel::Scalar;
+#endif
+}
+inline const char *get_kernel_name(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::AVX2:
+        return "avx2";
+    case Kernel::SSE:
+        return "sse";
+    default:
+        return "scalar";
+    }
+}
+
+/**
+ * @brief translation * rotation * scale of one object, premultiplied by viewProj if any, as a column major matrix
+ *
+ */
+inline void compose_matrix(const Store &store, uint32_t index, const float *viewProj, float *matrix)
+{
+    float x = store.rotationX[index];
+    float y = store.rotationY[index];
+    float z = store.rotationZ[index];
+    float w = store.rotationW[index];
+    float sx = store.scaleX[index];
+    float sy = store.scaleY[index];
+    float sz = store.scaleZ[index];
+
+    // same rotation as glm::mat3_cast
+    float model[16] = {
+        (1.f - 2.f * (y * y + z * z)) * sx,
+        2.f * (x * y + w * z) * sx,
+        2.f * (x * z - w * y) * sx,
+        0.f,
+        2.f * (x * y - w * z) * sy,
+        (1.f - 2.f * (x * x + z * z)) * sy,
+        2.f * (y * z + w * x) * sy,
+        0.f,
+        2.f * (x * z + w * y) * sz,
+        2.f * (y * z - w * x) * sz,
+        (1.f - 2.f * (x * x + y * y)) * sz,
+        0.f,
+        store.positionX[index],
+        store.positionY[index],
+        store.positionZ[index],
+        1.f,
+    };
+    if (!viewProj)
+    {
+        memcpy(matrix, model, sizeof(model));
+        return;
+    }
+
+    for (int column = 0; column < 4; ++column)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            matrix[column * 4 + row] = viewProj[row] * model[column * 4] + viewProj[4 + row] * model[column * 4 + 1] +
+                                       viewProj[8 + row] * model[column * 4 + 2] +
+                                       viewProj[12 + row] * model[column * 4 + 3];
+        }
+    }
+}
+
+#ifdef TRANSFORMS_SSE
+struct SSELanes
+{
+    using Float = __m128;
+    static constexpr uint32_t width = 4;
+
+    static Float load(const float *src)
+    {
+        return _mm_loadu_ps(src);
+    }
+    static Float set(float value)
+    {
+        return _mm_set1_ps(value);
+    }
+    static Float add(Float a, Float b)
+    {
+        return _mm_add_ps(a, b);
+    }
+    static Float sub(Float a, Float b)
+    {
+        return _mm_sub_ps(a, b);
+    }
+    static Float mul(Float a, Float b)
+    {
+        return _mm_mul_ps(a, b);
+    }
+
+    /**
+     * @brief columns[c][r] holds the element (c, r) of 4 objects, each object gets its 4 columns
+     *
+     */
+    static void store(Float columns[4][4], char *dst, size_t stride, bool bStream)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            Float r0 = columns[c][0], r1 = columns[c][1], r2 = columns[c][2], r3 = columns[c][3];
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            Float objects[4] = {r0, r1, r2, r3};
+            for (int i = 0; i < 4; ++i)
+            {
+                float *column = reinterpret_cast<float *>(dst + i * stride) + c * 4;
+                if (bStream)
+                    _mm_stream_ps(column, objects[i]);
+                else
+                    _mm_storeu_ps(column, objects[i]);
+            }
+        }
+    }
+};
+#endif
+
+#ifdef TRANSFORMS_AVX2
+struct AVX2Lanes
+{
+    using Float = __m256;
+    static constexpr uint32_t width = 8;
+
+    static Float load(const float *src)
+    {
+        return _mm256_loadu_ps(src);
+    }
+    static Float set(float value)
+    {
+        return _mm256_set1_ps(value);
+    }
+    static Float add(Float a, Float b)
+    {
+        return _mm256_add_ps(a, b);
+    }
+    static Float sub(Float a, Float b)
+    {
+        return _mm256_sub_ps(a, b);
+    }
+    static Float mul(Float a, Float b)
+    {
+        return _mm256_mul_ps(a, b);
+    }
+
+    /**
+     * @brief transposes within each 128 bits half, the low half holds objects 0 to 3 and the high half 4 to 7
+     *
+     */
+    static void store(Float columns[4][4], char *dst, size_t stride, bool bStream)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            Float t0 = _mm256_unpacklo_ps(columns[c][0], columns[c][1]);
+            Float t1 = _mm256_unpackhi_ps(columns[c][0], columns[c][1]);
+            Float t2 = _mm256_unpacklo_ps(columns[c][2], columns[c][3]);
+            Float t3 = _mm256_unpackhi_ps(columns[c][2], columns[c][3]);
+            Float objects[4] = {
+                _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+                _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+                _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+                _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)),
+            };
+            for (int i = 0; i < 4; ++i)
+            {
+                float *low = reinterpret_cast<float *>(dst + i * stride) + c * 4;
+                float *high = reinterpret_cast<float *>(dst + (i + 4) * stride) + c * 4;
+                __m128 lowObject = _mm256_castps256_ps128(objects[i]);
+                __m128 highObject = _mm256_extractf128_ps(objects[i], 1);
+                if (bStream)
+                {
+                    _mm_stream_ps(low, lowObject);
+                    _mm_stream_ps(high, highObject);
+                }
+                else
+                {
+                    _mm_storeu_ps(low, lowObject);
+                    _mm_storeu_ps(high, highObject);
+                }
+            }
+        }
+    }
+};
+#endif
+
+#if defined(TRANSFORMS_SSE) || defined(TRANSFORMS_AVX2)
+/**
+ * @brief compose Lanes::width consecutive objects starting at index, one object per lane
+ *
+ */
+template <typename Lanes>
+inline void compose_matrices(const Store &store, uint32_t index, const float *viewProj, char *dst, size_t stride,
+                             bool bStream)
+{
+    using Float = typename Lanes::Float;
+    Float x = Lanes::load(store.rotationX.data() + index);
+    Float y = Lanes::load(store.rotationY.data() + index);
+    Float z = Lanes::load(store.rotationZ.data() + index);
+    Float w = Lanes::load(store.rotationW.data() + index);
+    Float sx = Lanes::load(store.scaleX.data() + index);
+    Float sy = Lanes::load(store.scaleY.data() + index);
+    Float sz = Lanes::load(store.scaleZ.data() + index);
+
+    Float one = Lanes::set(1.f);
+    Float two = Lanes::set(2.f);
+    Float xx = Lanes::mul(x, x), yy = Lanes::mul(y, y), zz = Lanes::mul(z, z);
+    Float xy = Lanes::mul(x, y), xz = Lanes::mul(x, z), yz = Lanes::mul(y, z);
+    Float wx = Lanes::mul(w, x), wy = Lanes::mul(w, y), wz = Lanes::mul(w, z);
+
+    // model[c][r], same rotation as glm::mat3_cast
+    Float model[4][4] = {
+        {
+            Lanes::mul(Lanes::sub(one, Lanes::mul(two, Lanes::add(yy, zz))), sx),
+            Lanes::mul(Lanes::mul(two, Lanes::add(xy, wz)), sx),
+            Lanes::mul(Lanes::mul(two, Lanes::sub(xz, wy)), sx),
+            Lanes::set(0.f),
+        },
+        {
+            Lanes::mul(Lanes::mul(two, Lanes::sub(xy, wz)), sy),
+            Lanes::mul(Lanes::sub(one, Lanes::mul(two, Lanes::add(xx, zz))), sy),
+            Lanes::mul(Lanes::mul(two, Lanes::add(yz, wx)), sy),
+            Lanes::set(0.f),
+        },
+        {
+            Lanes::mul(Lanes::mul(two, Lanes::add(xz, wy)), sz),
+            Lanes::mul(Lanes::mul(two, Lanes::sub(yz, wx)), sz),
+            Lanes::mul(Lanes::sub(one, Lanes::mul(two, Lanes::add(xx, yy))), sz),
+            Lanes::set(0.f),
+        },
+        {
+            Lanes::load(store.positionX.data() + index),
+            Lanes::load(store.positionY.data() + index),
+            Lanes::load(store.positionZ.data() + index),
+            one,
+        },
+    };
+    if (!viewProj)
+    {
+        Lanes::store(model, dst + index * stride, stride, bStream);
+        return;
+    }
+
+    // the last row of the model is (0, 0, 0, 1)
+    Float matrix[4][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        for (int r = 0; r < 4; ++r)
+        {
+            Float element = Lanes::add(Lanes::add(Lanes::mul(Lanes::set(viewProj[r]), model[c][0]),
+                                                  Lanes::mul(Lanes::set(viewProj[4 + r]), model[c][1])),
+                                       Lanes::mul(Lanes::set(viewProj[8 + r]), model[c][2]));
+            matrix[c][r] = c == 3 ? Lanes::add(element, Lanes::set(viewProj[12 + r])) : element;
+        }
+    }
+    Lanes::store(matrix, dst + index * stride, stride, bStream);
+}
+#endif
+
+/**
+ * @brief write the matrix of the transforms [begin, end) at dst + index * stride
+ *
+ * dst is usually mapped memory, uniforms or instances of a frame. The SIMD kernels write with non temporal stores
+ * when every matrix is 16 bytes aligned, the write combined memory is then never read back into the cache.
+ *
+ * @param store
+ * @param begin
+ * @param end
+ * @param dst matrix of the transform 0
+ * @param stride bytes between two matrices, sizeof(glm::mat4) or the size of the structure holding it
+ * @param viewProj the model matrices are written if nullptr, model view projection matrices otherwise
+ * @param kernel falls back to the best supported kernel
+ */
+inline void write_matrices(const Store &store, uint32_t begin, uint32_t end, void *dst,
+                           size_t stride = sizeof(glm::mat4), const glm::mat4 *viewProj = nullptr,
+                           Kernel kernel = get_best_kernel())
+{
+    if (!is_kernel_supported(kernel))
+        kernel = get_best_kernel();
+
+    char *matrices = static_cast<char *>(dst);
+    // glm matrices are 16 contiguous floats, column major
+    const float *viewProjData = reinterpret_cast<const float *>(viewProj);
+    uint32_t index = begin;
+
+#if defined(TRANSFORMS_SSE) || defined(TRANSFORMS_AVX2)
+    bool bStream = (reinterpret_cast<uintptr_t>(matrices) % 16) == 0 && (stride % 16) == 0;
+#endif
+#ifdef TRANSFORMS_AVX2
+    if (kernel == Kernel::AVX2)
+    {
+        for (; index + AVX2Lanes::width <= end; index += AVX2Lanes::width)
+            compose_matrices<AVX2Lanes>(store, index, viewProjData, matrices, stride, bStream);
+    }
+#endif
+#ifdef TRANSFORMS_SSE
+    if (kernel != Kernel::Scalar)
+    {
+        for (; index + SSELanes::width <= end; index += SSELanes::width)
+            compose_matrices<SSELanes>(store, index, viewProjData, matrices, stride, bStream);
+    }
+    // the non temporal stores are weakly ordered, make them visible before the submission
+    if (kernel != Kernel::Scalar && bStream)
+        _mm_sfence();
+#endif
+
+    for (; index < end; ++index)
+    {
+        float matrix[16];
+        compose_matrix(store, index, viewProjData, matrix);
+        memcpy(matrices + index * stride, matrix, sizeof(matrix));
+    }
+}
+} // namespace Transforms
@@ -1,10 +1,40 @@
 #pragma once
 
+#include <cstdint>
+
 #include <glm/glm.hpp>
 
+/**
+ * @brief per frame data, the per object data is pushed with the draws
+ *
+ */
 struct UniformBufferObjectT
 {
-    glm::mat4 model;
     glm::mat4 view;
     glm::mat4 proj;
+};
+
+/**
+ * @brief push constants of the draws, 80 of the 128 bytes every device supports
+ *
+ */
+struct DrawConstantsT
+{
+    glm::mat4 model;
+    uint32_t materialID = 0;
+    // slot of the material buffer in the bindless table
+    uint32_t materialBuffer = 0;
+    uint32_t padding[2] = {};
+};
+
+/**
+ * @brief material of the bindless draws, std430 layout
+ *
+ */
+struct MaterialT
+{
+    glm::vec4 color;
+    // slot of the texture in the bindless table
+    uint32_t textureIndex;
+    uint32_t padding[3] = {};
 };
\ No newline at end of file
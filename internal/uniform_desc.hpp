@@ -7,12 +7,21 @@
 
 namespace UniformDesc
 {
-inline std::vector<VkDescriptorSetLayoutBinding> get_uniform_descriptor_set_layout_bindings()
+/**
+ * @brief a dynamic uniform buffer is bound with an offset, one set serves every object of a uniform arena
+ *
+ */
+inline VkDescriptorType get_uniform_descriptor_type(bool bDynamic)
+{
+    return bDynamic ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+}
+
+inline std::vector<VkDescriptorSetLayoutBinding> get_uniform_descriptor_set_layout_bindings(bool bDynamic = false)
 {
     std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
         VkDescriptorSetLayoutBinding{
             .binding = 0,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorType = get_uniform_descriptor_type(bDynamic),
             .descriptorCount = 1,
             .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
             .pImmutableSamplers = nullptr,
@@ -27,10 +36,11 @@ inline std::vector<VkDescriptorSetLayoutBinding> get_uniform_descriptor_set_layo
     return setLayoutBindings;
 }
 
-inline std::vector<VkDescriptorPoolSize> get_uniform_descriptor_pool_sizes(uint32_t frameInFlightCount)
+inline std::vector<VkDescriptorPoolSize> get_uniform_descriptor_pool_sizes(uint32_t frameInFlightCount,
+                                                                           bool bDynamic = false)
 {
     std::vector<VkDescriptorPoolSize> poolSizes = {VkDescriptorPoolSize{
-                                                       .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                       .type = get_uniform_descriptor_type(bDynamic),
                                                        .descriptorCount = frameInFlightCount,
                                                    },
                                                    VkDescriptorPoolSize{
@@ -39,9 +49,23 @@ inline std::vector<VkDescriptorPoolSize> get_uniform_descriptor_pool_sizes(uint3
                                                    }};
     return poolSizes;
 }
+/**
+ * @brief DrawConstantsT, shared by the layouts of every pipeline so that the constants outlive pipeline changes
+ *
+ */
+inline std::vector<VkPushConstantRange> get_draw_push_constant_ranges()
+{
+    return std::vector<VkPushConstantRange>{VkPushConstantRange{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        .offset = 0,
+        .size = sizeof(DrawConstantsT),
+    }};
+}
+
 inline std::vector<VkWriteDescriptorSet> get_uniform_descriptor_set_writes(VkDescriptorSet descriptorSet,
                                                                            const VkDescriptorBufferInfo &bufferInfo,
-                                                                           const VkDescriptorImageInfo &imageInfo)
+                                                                           const VkDescriptorImageInfo &imageInfo,
+                                                                           bool bDynamic = false)
 {
     return std::vector<VkWriteDescriptorSet>{VkWriteDescriptorSet{
                                                  .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -49,7 +73,7 @@ inline std::vector<VkWriteDescriptorSet> get_uniform_descriptor_set_writes(VkDes
                                                  .dstBinding = 0,
                                                  .dstArrayElement = 0,
                                                  .descriptorCount = 1,
-                                                 .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                 .descriptorType = get_uniform_descriptor_type(bDynamic),
                                                  .pBufferInfo = &bufferInfo,
                                                  .pTexelBufferView = nullptr,
                                              },
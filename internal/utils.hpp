@@ -1,9 +1,25 @@
 #pragma once
 
+#include <filesystem>
 #include <fstream>
 #include <string>
 #include <vector>
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 /**
  * return success
  */
@@ -25,3 +41,119 @@ static inline bool read_binary_file(const std::string &filename, std::vector<cha
     file.close();
     return true;
 }
+
+/**
+ * return success
+ */
+static inline bool write_binary_file(const std::string &filename, const std::vector<char> &data)
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open file : " << filename << std::endl;
+        return false;
+    }
+
+    file.write(data.data(), data.size());
+
+    file.close();
+    return !file.fail();
+}
+/**
+ * write a temporary file next to filename then rename it over filename, readers never see a truncated or partially
+ * written file
+ * return success
+ */
+static inline bool replace_binary_file(const std::string &filename, const std::vector<char> &data)
+{
+    std::string tmpFilename = filename + ".tmp";
+    if (!write_binary_file(tmpFilename, data))
+        return false;
+
+    std::error_code error;
+    std::filesystem::rename(tmpFilename, filename, error);
+    if (error)
+    {
+        std::cerr << "Failed to replace file : " << filename << " (" << error.message() << ")" << std::endl;
+        std::filesystem::remove(tmpFilename, error);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * read-only view of a whole file, page aligned
+ */
+struct MappedFile
+{
+    const void *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+static inline void unmap_file(MappedFile &file)
+{
+#ifdef _WIN32
+    if (file.data)
+        UnmapViewOfFile(file.data);
+    if (file.mapping)
+        CloseHandle(file.mapping);
+    if (file.file != INVALID_HANDLE_VALUE)
+        CloseHandle(file.file);
+    file.mapping = nullptr;
+    file.file = INVALID_HANDLE_VALUE;
+#else
+    if (file.data)
+        munmap(const_cast<void *>(file.data), file.size);
+#endif
+    file.data = nullptr;
+    file.size = 0;
+}
+
+/**
+ * return success
+ */
+static inline bool map_file(const std::string &filename, MappedFile &out)
+{
+#ifdef _WIN32
+    out.file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (out.file == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "Failed to open file : " << filename << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(out.file, &fileSize);
+    out.size = static_cast<size_t>(fileSize.QuadPart);
+    out.mapping = CreateFileMappingA(out.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    out.data = out.mapping ? MapViewOfFile(out.mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open file : " << filename << std::endl;
+        return false;
+    }
+
+    struct stat fileStat;
+    fstat(fd, &fileStat);
+    out.size = static_cast<size_t>(fileStat.st_size);
+    void *data = out.size > 0 ? mmap(nullptr, out.size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    // the mapping stays valid once the descriptor is closed
+    close(fd);
+    out.data = data != MAP_FAILED ? data : nullptr;
+#endif
+
+    if (!out.data)
+    {
+        std::cerr << "Failed to map file : " << filename << std::endl;
+        unmap_file(out);
+        return false;
+    }
+    return true;
+}
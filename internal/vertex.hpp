@@ -1,11 +1,62 @@
 #pragma once
 
+#include <cstdint>
+
 #include <glm/glm.hpp>
 
-class Vertex
+// compact attribute types, expanded back to floats by the vertex input
+struct Half2
+{
+    uint16_t x, y;
+};
+/**
+ * @brief half float position, w pads to a format supported as a vertex buffer (w = 1)
+ *
+ */
+struct Half4
+{
+    uint16_t x, y, z, w;
+};
+struct Unorm8x4
+{
+    uint8_t x, y, z, w;
+};
+/**
+ * @brief 16 bits fixed point in [0, 1], for texture coordinates that do not repeat
+ *
+ */
+struct Unorm16x2
+{
+    uint16_t x, y;
+};
+
+/**
+ * @brief vertex layout given by the types of its attributes, the input descriptions are deduced from them
+ *
+ */
+template <typename PositionT, typename ColorT, typename UVT> class VertexT
+{
+  public:
+    using Position = PositionT;
+    using Color = ColorT;
+    using UV = UVT;
+
+    PositionT position;
+    ColorT color;
+    UVT uv;
+};
+
+using Vertex = VertexT<glm::vec3, glm::vec4, glm::vec2>;
+using QuantizedVertex = VertexT<Half4, Unorm8x4, Unorm16x2>;
+static_assert(sizeof(Vertex) == 36 && sizeof(QuantizedVertex) == 16);
+
+/**
+ * @brief per-instance attributes, read once per instance from a second vertex buffer
+ *
+ */
+class Instance
 {
   public:
-    glm::vec3 position;
+    glm::mat4 model;
     glm::vec4 color;
-    glm::vec2 uv;
 };
@@ -1,29 +1,110 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <vulkan/vulkan.h>
 
 #include "vertex.hpp"
 
 namespace VertexDesc
 {
-inline VkVertexInputBindingDescription get_vertex_input_binding_description()
+/**
+ * @brief vertex input format of an attribute type, undefined for the types without a format
+ *
+ */
+template <typename T> struct AttributeFormat;
+template <> struct AttributeFormat<glm::vec2>
+{
+    static constexpr VkFormat value = VK_FORMAT_R32G32_SFLOAT;
+};
+template <> struct AttributeFormat<glm::vec3>
+{
+    static constexpr VkFormat value = VK_FORMAT_R32G32B32_SFLOAT;
+};
+template <> struct AttributeFormat<glm::vec4>
+{
+    static constexpr VkFormat value = VK_FORMAT_R32G32B32A32_SFLOAT;
+};
+template <> struct AttributeFormat<Half2>
+{
+    static constexpr VkFormat value = VK_FORMAT_R16G16_SFLOAT;
+};
+template <> struct AttributeFormat<Half4>
+{
+    static constexpr VkFormat value = VK_FORMAT_R16G16B16A16_SFLOAT;
+};
+template <> struct AttributeFormat<Unorm8x4>
+{
+    static constexpr VkFormat value = VK_FORMAT_R8G8B8A8_UNORM;
+};
+template <> struct AttributeFormat<Unorm16x2>
+{
+    static constexpr VkFormat value = VK_FORMAT_R16G16_UNORM;
+};
+
+template <typename V = Vertex> constexpr VkVertexInputBindingDescription get_vertex_input_binding_description()
 {
     // describe the buffer data
     VkVertexInputBindingDescription desc = {.binding = 0,
-                                            .stride = sizeof(Vertex),
+                                            .stride = sizeof(V),
                                             // update every vertex (opposed to VK_VERTEX_INPUT_RATE_INSTANCE)
                                             .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
 
     return desc;
 }
-inline std::array<VkVertexInputAttributeDescription, 3> get_vertex_input_attribute_description()
+/**
+ * @brief the formats follow the attribute types of V, the shaders read floats whatever the layout
+ *
+ */
+template <typename V = Vertex>
+constexpr std::array<VkVertexInputAttributeDescription, 3> get_vertex_input_attribute_description()
 {
     // attribute pointer
-    std::array<VkVertexInputAttributeDescription, 3> desc;
-    desc[0] = {.location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Vertex, position)};
-    desc[1] = {.location = 1, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(Vertex, color)};
-    desc[2] = {.location = 2, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(Vertex, uv)};
+    std::array<VkVertexInputAttributeDescription, 3> desc = {};
+    desc[0] = {.location = 0,
+               .binding = 0,
+               .format = AttributeFormat<typename V::Position>::value,
+               .offset = offsetof(V, position)};
+    desc[1] = {.location = 1,
+               .binding = 0,
+               .format = AttributeFormat<typename V::Color>::value,
+               .offset = offsetof(V, color)};
+    desc[2] = {.location = 2,
+               .binding = 0,
+               .format = AttributeFormat<typename V::UV>::value,
+               .offset = offsetof(V, uv)};
+    return desc;
+}
+static_assert(get_vertex_input_attribute_description<QuantizedVertex>()[1].offset == 8);
+
+inline VkVertexInputBindingDescription get_instance_input_binding_description(uint32_t binding = 1)
+{
+    VkVertexInputBindingDescription desc = {.binding = binding,
+                                            .stride = sizeof(Instance),
+                                            // update every instance
+                                            .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE};
+
+    return desc;
+}
+/**
+ * @brief the model matrix takes one location per column, following the Vertex attributes
+ *
+ */
+inline std::array<VkVertexInputAttributeDescription, 5> get_instance_input_attribute_description(
+    uint32_t binding = 1, uint32_t firstLocation = 3)
+{
+    std::array<VkVertexInputAttributeDescription, 5> desc;
+    for (uint32_t column = 0; column < 4; ++column)
+    {
+        desc[column] = {.location = firstLocation + column,
+                        .binding = binding,
+                        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                        .offset = static_cast<uint32_t>(offsetof(Instance, model) + sizeof(glm::vec4) * column)};
+    }
+    desc[4] = {.location = firstLocation + 4,
+               .binding = binding,
+               .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+               .offset = offsetof(Instance, color)};
     return desc;
 }
 } // namespace VertexDesc
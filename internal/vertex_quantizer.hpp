@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <glm/gtc/packing.hpp>
+
+#include "vertex.hpp"
+
+// Conversion of imported meshes to the compact vertex layouts, the vertex input converts them back to floats
+namespace VertexQuantizer
+{
+inline void quantize_attribute(const glm::vec3 &src, Half4 &dst)
+{
+    uint64_t packed = glm::packHalf4x16(glm::vec4(src, 1.f));
+    memcpy(&dst, &packed, sizeof(dst));
+}
+inline void quantize_attribute(const glm::vec2 &src, Half2 &dst)
+{
+    uint32_t packed = glm::packHalf2x16(src);
+    memcpy(&dst, &packed, sizeof(dst));
+}
+inline void quantize_attribute(const glm::vec4 &src, Unorm8x4 &dst)
+{
+    // clamped to [0, 1] and rounded to the nearest step
+    uint32_t packed = glm::packUnorm4x8(src);
+    memcpy(&dst, &packed, sizeof(dst));
+}
+inline void quantize_attribute(const glm::vec2 &src, Unorm16x2 &dst)
+{
+    uint32_t packed = glm::packUnorm2x16(src);
+    memcpy(&dst, &packed, sizeof(dst));
+}
+/**
+ * @brief attributes kept at full precision
+ *
+ */
+template <typename T> inline void quantize_attribute(const T &src, T &dst)
+{
+    dst = src;
+}
+
+inline void dequantize_attribute(const Half4 &src, glm::vec3 &dst)
+{
+    uint64_t packed;
+    memcpy(&packed, &src, sizeof(src));
+    dst = glm::vec3(glm::unpackHalf4x16(packed));
+}
+inline void dequantize_attribute(const Half2 &src, glm::vec2 &dst)
+{
+    uint32_t packed;
+    memcpy(&packed, &src, sizeof(src));
+    dst = glm::unpackHalf2x16(packed);
+}
+inline void dequantize_attribute(const Unorm8x4 &src, glm::vec4 &dst)
+{
+    uint32_t packed;
+    memcpy(&packed, &src, sizeof(src));
+    dst = glm::unpackUnorm4x8(packed);
+}
+inline void dequantize_attribute(const Unorm16x2 &src, glm::vec2 &dst)
+{
+    uint32_t packed;
+    memcpy(&packed, &src, sizeof(src));
+    dst = glm::unpackUnorm2x16(packed);
+}
+template <typename T> inline void dequantize_attribute(const T &src, T &dst)
+{
+    dst = src;
+}
+
+/**
+ * @brief convert a full precision vertex to the layout V, attribute by attribute
+ *
+ */
+template <typename V> inline V quantize_vertex(const Vertex &vertex)
+{
+    V quantized;
+    quantize_attribute(vertex.position, quantized.position);
+    quantize_attribute(vertex.color, quantized.color);
+    quantize_attribute(vertex.uv, quantized.uv);
+    return quantized;
+}
+/**
+ * @brief the vertex as read by the shaders
+ *
+ */
+template <typename V> inline Vertex dequantize_vertex(const V &quantized)
+{
+    Vertex vertex;
+    dequantize_attribute(quantized.position, vertex.position);
+    dequantize_attribute(quantized.color, vertex.color);
+    dequantize_attribute(quantized.uv, vertex.uv);
+    return vertex;
+}
+
+template <typename V> inline std::vector<V> quantize_vertices(const std::vector<Vertex> &vertices)
+{
+    std::vector<V> quantized(vertices.size());
+    std::transform(vertices.begin(), vertices.end(), quantized.begin(), quantize_vertex<V>);
+    return quantized;
+}
+
+/**
+ * @brief largest position difference introduced by the layout V, to check that a mesh fits in it
+ *
+ * Half floats keep 11 significant bits : positions far from the origin of the mesh lose precision first.
+ *
+ */
+template <typename V> inline float get_max_position_error(const std::vector<Vertex> &vertices)
+{
+    float maxError = 0.f;
+    for (const Vertex &vertex : vertices)
+    {
+        glm::vec3 position = dequantize_vertex(quantize_vertex<V>(vertex)).position;
+        for (int i = 0; i < 3; ++i)
+            maxError = (std::max)(maxError, std::abs(position[i] - vertex.position[i]));
+    }
+    return maxError;
+}
+} // namespace VertexQuantizer
@@ -6,12 +6,25 @@
 
 #include <volk.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <initializer_list>
 #include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <set>
+#include <string>
+#include <tuple>
 #include <vector>
 
+#include "pipeline_desc.hpp"
 #include "utils.hpp"
 #include "vertex.hpp"
 #include "vertex_desc.hpp"
@@ -316,7 +329,12 @@ inline std::optional<uint32_t> find_memory_type_index(VkPhysicalDevice physicalD
 
 namespace Queue
 {
-inline std::optional<uint32_t> find_queue_family_index(VkPhysicalDevice physicalDevice, VkQueueFlags flags)
+/**
+ * @brief find a queue family supporting flags, excludedFlags allows to look for dedicated families (e.g. transfer only)
+ *
+ */
+inline std::optional<uint32_t> find_queue_family_index(VkPhysicalDevice physicalDevice, VkQueueFlags flags,
+                                                       VkQueueFlags excludedFlags = 0)
 {
     std::optional<uint32_t> index;
 
@@ -327,7 +345,7 @@ inline std::optional<uint32_t> find_queue_family_index(VkPhysicalDevice physical
     for (uint32_t i = 0; i < queueFamilies.size(); ++i)
     {
         // queue family capable of specified flags operations
-        if (queueFamilies[i].queueFlags & flags)
+        if ((queueFamilies[i].queueFlags & flags) && !(queueFamilies[i].queueFlags & excludedFlags))
             index = i;
     }
 
@@ -362,21 +380,70 @@ inline VkQueue get_device_queue(VkDevice device, uint32_t queueFamilyIndex, uint
     vkGetDeviceQueue(device, queueFamilyIndex, queueIndex, &queue);
     return queue;
 }
+
+/**
+ * @brief queue family only capable of transfer operations, usually backed by DMA engines
+ *
+ */
+inline std::optional<uint32_t> find_transfer_queue_family_index(VkPhysicalDevice physicalDevice)
+{
+    return find_queue_family_index(physicalDevice, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+}
+/**
+ * @brief queue family capable of compute but not graphics operations, its work overlaps the graphics queue
+ *
+ */
+inline std::optional<uint32_t> find_async_compute_queue_family_index(VkPhysicalDevice physicalDevice)
+{
+    return find_queue_family_index(physicalDevice, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+}
 } // namespace Queue
 
+/**
+ * @brief optional features enabled on the logical device, the ones supported by the physical device
+ *
+ */
+struct EnabledFeatures
+{
+    VkPhysicalDeviceFeatures features;
+    // pNext is cleared
+    VkPhysicalDeviceVulkan12Features features12;
+};
+
+/**
+ * @brief Create a logical device object with a queue of every family used
+ *
+ * @param instance
+ * @param physicalDevice
+ * @param surface nullptr when headless
+ * @param layers
+ * @param deviceExtensions
+ * @param bAsyncCompute also create a queue of the async compute family, if any
+ * @param pEnabledFeatures written with the optional features enabled, nullptr to ignore them
+ * @return VkDevice
+ */
 inline VkDevice create_logical_device(VkInstance instance, VkPhysicalDevice physicalDevice, VkSurfaceKHR *surface,
-                                      std::vector<const char *> layers, std::vector<const char *> deviceExtensions)
+                                      std::vector<const char *> layers, std::vector<const char *> deviceExtensions,
+                                      bool bAsyncCompute = false, EnabledFeatures *pEnabledFeatures = nullptr)
 {
     std::optional<uint32_t> graphicsFamilyIndex = Queue::find_queue_family_index(physicalDevice, VK_QUEUE_GRAPHICS_BIT);
     std::optional<uint32_t> presentFamilyIndex;
     if (surface)
         presentFamilyIndex = Queue::find_present_queue_family_index(physicalDevice, *surface);
+    std::optional<uint32_t> transferFamilyIndex = Queue::find_transfer_queue_family_index(physicalDevice);
+    std::optional<uint32_t> computeFamilyIndex;
+    if (bAsyncCompute)
+        computeFamilyIndex = Queue::find_async_compute_queue_family_index(physicalDevice);
 
     std::set<uint32_t> queueFamilyIndices;
     if (graphicsFamilyIndex.has_value())
         queueFamilyIndices.insert(graphicsFamilyIndex.value());
     if (presentFamilyIndex.has_value())
         queueFamilyIndices.insert(presentFamilyIndex.value());
+    if (transferFamilyIndex.has_value())
+        queueFamilyIndices.insert(transferFamilyIndex.value());
+    if (computeFamilyIndex.has_value())
+        queueFamilyIndices.insert(computeFamilyIndex.value());
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     float queuePriority = 1.f;
@@ -390,8 +457,52 @@ inline VkDevice create_logical_device(VkInstance instance, VkPhysicalDevice phys
         });
     }
 
+    // timeline semaphores track the asynchronous uploads
+    VkPhysicalDeviceVulkan12Features supportedFeatures12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+    };
+    VkPhysicalDeviceFeatures2 supportedFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &supportedFeatures12,
+    };
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+    if (!supportedFeatures12.timelineSemaphore)
+        std::cerr << "Timeline semaphores are not supported by the physical device" << std::endl;
+
+    VkPhysicalDeviceVulkan12Features features12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .drawIndirectCount = supportedFeatures12.drawIndirectCount,
+        // bindless tables, arrays of descriptors updated while bound and indexed from the shaders
+        .descriptorIndexing = supportedFeatures12.descriptorIndexing,
+        .shaderSampledImageArrayNonUniformIndexing = supportedFeatures12.shaderSampledImageArrayNonUniformIndexing,
+        .shaderStorageBufferArrayNonUniformIndexing = supportedFeatures12.shaderStorageBufferArrayNonUniformIndexing,
+        .descriptorBindingSampledImageUpdateAfterBind =
+            supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind,
+        .descriptorBindingStorageBufferUpdateAfterBind =
+            supportedFeatures12.descriptorBindingStorageBufferUpdateAfterBind,
+        .descriptorBindingPartiallyBound = supportedFeatures12.descriptorBindingPartiallyBound,
+        .runtimeDescriptorArray = supportedFeatures12.runtimeDescriptorArray,
+        .timelineSemaphore = supportedFeatures12.timelineSemaphore,
+    };
+    // statistics and sample counts of the instrumented passes, draws generated by the device, bindless buffers
+    // selected by a push constant, when supported
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &features12,
+        .features =
+            {
+                .multiDrawIndirect = supportedFeatures.features.multiDrawIndirect,
+                .drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance,
+                .occlusionQueryPrecise = supportedFeatures.features.occlusionQueryPrecise,
+                .pipelineStatisticsQuery = supportedFeatures.features.pipelineStatisticsQuery,
+                .shaderStorageBufferArrayDynamicIndexing =
+                    supportedFeatures.features.shaderStorageBufferArrayDynamicIndexing,
+            },
+    };
+
     VkDeviceCreateInfo createInfo = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = &features,
         .queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
         .pQueueCreateInfos = queueCreateInfos.data(),
         .enabledLayerCount = static_cast<uint32_t>(layers.size()),
@@ -405,6 +516,13 @@ inline VkDevice create_logical_device(VkInstance instance, VkPhysicalDevice phys
     if (res != VK_SUCCESS)
         std::cerr << "Failed to create logical device : " << res << std::endl;
 
+    if (pEnabledFeatures)
+    {
+        pEnabledFeatures->features = features.features;
+        pEnabledFeatures->features12 = features12;
+        pEnabledFeatures->features12.pNext = nullptr;
+    }
+
     volkLoadDevice(device);
 
     return device;
@@ -568,7 +686,17 @@ inline std::vector<VkImage> get_swap_chain_images(VkDevice device, VkSwapchainKH
 
 namespace RenderPass
 {
-inline VkRenderPass create_render_pass(VkDevice device, VkFormat colorAttachmentFormat, VkFormat depthAttachmentFormat)
+/**
+ * @brief Create a render pass object with a color and a depth attachment
+ *
+ * @param device
+ * @param colorAttachmentFormat
+ * @param depthAttachmentFormat
+ * @param colorFinalLayout layout of the color attachment after the render pass, to present or to sample/copy offscreen
+ * @return VkRenderPass
+ */
+inline VkRenderPass create_render_pass(VkDevice device, VkFormat colorAttachmentFormat, VkFormat depthAttachmentFormat,
+                                       VkImageLayout colorFinalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
 {
     VkAttachmentDescription colorAttachment = {
         .format = colorAttachmentFormat,
@@ -580,7 +708,7 @@ inline VkRenderPass create_render_pass(VkDevice device, VkFormat colorAttachment
         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        .finalLayout = colorFinalLayout,
     };
 
     VkAttachmentReference colorAttachmentRef = {
@@ -611,14 +739,28 @@ inline VkRenderPass create_render_pass(VkDevice device, VkFormat colorAttachment
         .pDepthStencilAttachment = &depthAttachmentRef,
     };
 
+    // the transfer stage orders the clear after the copies of the previous frame reading the image (readbacks)
     VkSubpassDependency dependency = {
         .srcSubpass = VK_SUBPASS_EXTERNAL,
         .dstSubpass = 0,
-        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                        VK_PIPELINE_STAGE_TRANSFER_BIT,
         .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-        .srcAccessMask = 0,
+        .srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
         .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
     };
+    // offscreen, the color attachment is copied or sampled by the commands submitted after the render pass
+    VkSubpassDependency readDependency = {
+        .srcSubpass = 0,
+        .dstSubpass = VK_SUBPASS_EXTERNAL,
+        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+    };
+    std::vector<VkSubpassDependency> dependencies = {dependency};
+    if (colorFinalLayout != VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+        dependencies.emplace_back(readDependency);
 
     std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
     VkRenderPassCreateInfo createInfo = {
@@ -627,8 +769,8 @@ inline VkRenderPass create_render_pass(VkDevice device, VkFormat colorAttachment
         .pAttachments = attachments.data(),
         .subpassCount = 1,
         .pSubpasses = &subpass,
-        .dependencyCount = 1,
-        .pDependencies = &dependency,
+        .dependencyCount = static_cast<uint32_t>(dependencies.size()),
+        .pDependencies = dependencies.data(),
     };
 
     VkRenderPass renderPass;
@@ -702,11 +844,234 @@ inline void destroy_shader_module(VkDevice device, VkShaderModule module)
     vkDestroyShaderModule(device, module, nullptr);
 }
 
-inline VkDescriptorSetLayout create_descriptor_set_layout(VkDevice device,
-                                                          std::vector<VkDescriptorSetLayoutBinding> layoutBindings)
+/**
+ * @brief shader modules shared by the pipelines, identical SPIR-V files share the same module
+ *
+ */
+struct ModuleCache
+{
+    struct Module
+    {
+        VkShaderModule module;
+        uint32_t refCount;
+        // tell apart the modules whose SPIR-V have the same hash without keeping a copy of the code
+        size_t codeSize;
+        uint64_t checkHash;
+    };
+
+    VkDevice device;
+
+    // accessed from the pipeline compilation threads
+    std::mutex mutex;
+    // content hash and module of the files already read
+    std::map<std::string, std::pair<uint64_t, VkShaderModule>> pathModules;
+    std::map<uint64_t, std::vector<Module>> modules;
+};
+
+/**
+ * @brief FNV-1a over the SPIR-V words
+ *
+ */
+inline uint64_t hash_spirv(const uint32_t *code, size_t wordCount)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < wordCount; ++i)
+    {
+        hash ^= code[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief splitmix64 rounds over the SPIR-V words, independent of hash_spirv
+ *
+ */
+inline uint64_t hash_spirv_check(const uint32_t *code, size_t wordCount)
+{
+    uint64_t hash = wordCount;
+    for (size_t i = 0; i < wordCount; ++i)
+    {
+        hash += code[i] + 0x9e3779b97f4a7c15ull;
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+        hash ^= hash >> 31;
+    }
+    return hash;
+}
+
+inline std::unique_ptr<ModuleCache> create_module_cache(VkDevice device)
+{
+    auto moduleCache = std::make_unique<ModuleCache>();
+    moduleCache->device = device;
+    return moduleCache;
+}
+/**
+ * @brief Get the shader module of a SPIR-V file, the file is only read the first time its path is seen
+ *
+ * The file is memory mapped and the module is created straight from the mapping, which is page aligned as pCode
+ * requires. Every call must be matched with release_shader_module.
+ *
+ * @param moduleCache
+ * @param path
+ * @return VkShaderModule VK_NULL_HANDLE if the file could not be read or its module could not be created
+ */
+inline VkShaderModule acquire_shader_module(ModuleCache &moduleCache, const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(moduleCache.mutex);
+
+    auto pathModule = moduleCache.pathModules.find(path);
+    if (pathModule != moduleCache.pathModules.end())
+    {
+        auto [hash, shaderModule] = pathModule->second;
+        for (ModuleCache::Module &module : moduleCache.modules[hash])
+        {
+            if (module.module == shaderModule)
+            {
+                ++module.refCount;
+                return module.module;
+            }
+        }
+    }
+
+    MappedFile file;
+    if (!map_file(path, file))
+        return VK_NULL_HANDLE;
+    if (file.size == 0 || file.size % sizeof(uint32_t) != 0)
+    {
+        std::cerr << "Failed to load shader module, invalid SPIR-V size : " << path << " (" << file.size << " bytes)"
+                  << std::endl;
+        unmap_file(file);
+        return VK_NULL_HANDLE;
+    }
+
+    const uint32_t *code = static_cast<const uint32_t *>(file.data);
+    size_t wordCount = file.size / sizeof(uint32_t);
+    uint64_t hash = hash_spirv(code, wordCount);
+    uint64_t checkHash = hash_spirv_check(code, wordCount);
+
+    std::vector<ModuleCache::Module> &candidates = moduleCache.modules[hash];
+    auto module = std::find_if(candidates.begin(), candidates.end(), [&file, checkHash](const ModuleCache::Module &m) {
+        return m.codeSize == file.size && m.checkHash == checkHash;
+    });
+    if (module == candidates.end())
+    {
+        VkShaderModuleCreateInfo createInfo = {
+            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .codeSize = file.size,
+            .pCode = code,
+        };
+        VkShaderModule shaderModule;
+        VkResult res = vkCreateShaderModule(moduleCache.device, &createInfo, nullptr, &shaderModule);
+        if (res != VK_SUCCESS)
+        {
+            std::cerr << "Failed to create shader module : " << res << std::endl;
+            unmap_file(file);
+            if (candidates.empty())
+                moduleCache.modules.erase(hash);
+            return VK_NULL_HANDLE;
+        }
+        module = candidates.insert(candidates.end(), ModuleCache::Module{shaderModule, 0, file.size, checkHash});
+    }
+    unmap_file(file);
+
+    moduleCache.pathModules[path] = {hash, module->module};
+    ++module->refCount;
+    return module->module;
+}
+/**
+ * @brief the module stays in the cache once unreferenced, until trim_module_cache
+ *
+ */
+inline void release_shader_module(ModuleCache &moduleCache, VkShaderModule shaderModule)
+{
+    std::lock_guard<std::mutex> lock(moduleCache.mutex);
+    for (auto &[hash, modules] : moduleCache.modules)
+    {
+        for (ModuleCache::Module &module : modules)
+        {
+            if (module.module == shaderModule && module.refCount > 0)
+            {
+                --module.refCount;
+                return;
+            }
+        }
+    }
+}
+/**
+ * @brief forget a path so that the file is read again on the next acquire, e.g. once the file has changed
+ *
+ */
+inline void invalidate_shader_path(ModuleCache &moduleCache, const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(moduleCache.mutex);
+    moduleCache.pathModules.erase(path);
+}
+/**
+ * @brief destroy the modules that are no longer referenced
+ *
+ */
+inline void trim_module_cache(ModuleCache &moduleCache)
+{
+    std::lock_guard<std::mutex> lock(moduleCache.mutex);
+    for (auto &[hash, modules] : moduleCache.modules)
+    {
+        for (auto module = modules.begin(); module != modules.end();)
+        {
+            if (module->refCount > 0)
+            {
+                ++module;
+                continue;
+            }
+
+            destroy_shader_module(moduleCache.device, module->module);
+            for (auto pathModule = moduleCache.pathModules.begin(); pathModule != moduleCache.pathModules.end();)
+            {
+                if (pathModule->second.second == module->module)
+                    pathModule = moduleCache.pathModules.erase(pathModule);
+                else
+                    ++pathModule;
+            }
+            module = modules.erase(module);
+        }
+    }
+    std::erase_if(moduleCache.modules, [](const auto &bucket) { return bucket.second.empty(); });
+}
+inline void destroy_module_cache(std::unique_ptr<ModuleCache> &moduleCache)
+{
+    for (auto &[hash, modules] : moduleCache->modules)
+    {
+        for (ModuleCache::Module &module : modules)
+            destroy_shader_module(moduleCache->device, module.module);
+    }
+    moduleCache.reset();
+}
+
+/**
+ * @brief Create a descriptor set layout object
+ *
+ * @param device
+ * @param layoutBindings
+ * @param bindingFlags empty, or one per binding (descriptor indexing), the sets of a layout with update after bind
+ * bindings must be allocated from an update after bind pool
+ * @return VkDescriptorSetLayout
+ */
+inline VkDescriptorSetLayout create_descriptor_set_layout(
+    VkDevice device, std::vector<VkDescriptorSetLayoutBinding> layoutBindings,
+    const std::vector<VkDescriptorBindingFlags> &bindingFlags = {})
 {
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(bindingFlags.size()),
+        .pBindingFlags = bindingFlags.data(),
+    };
+    bool bUpdateAfterBind =
+        std::any_of(bindingFlags.begin(), bindingFlags.end(),
+                    [](VkDescriptorBindingFlags flags) { return flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT; });
     VkDescriptorSetLayoutCreateInfo createInfo = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = bindingFlags.empty() ? nullptr : &bindingFlagsInfo,
+        .flags = bUpdateAfterBind ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0u,
         .bindingCount = static_cast<uint32_t>(layoutBindings.size()),
         .pBindings = layoutBindings.data(),
     };
@@ -723,14 +1088,15 @@ inline void destroy_descriptor_set_layout(VkDevice device, VkDescriptorSetLayout
     vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
 }
 
-inline VkPipelineLayout create_pipeline_layout(VkDevice device, const std::vector<VkDescriptorSetLayout> &setLayouts)
+inline VkPipelineLayout create_pipeline_layout(VkDevice device, const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                               const std::vector<VkPushConstantRange> &pushConstantRanges = {})
 {
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
         .pSetLayouts = setLayouts.data(),
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = nullptr,
+        .pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size()),
+        .pPushConstantRanges = pushConstantRanges.data(),
     };
 
     VkPipelineLayout pipelineLayout;
@@ -746,10 +1112,11 @@ inline void destroy_pipeline_layout(VkDevice device, VkPipelineLayout pipelineLa
 }
 
 inline VkDescriptorPool create_descriptor_pool(VkDevice device, std::vector<VkDescriptorPoolSize> poolSizes,
-                                               uint32_t frameInFlightCount)
+                                               uint32_t frameInFlightCount, VkDescriptorPoolCreateFlags flags = 0)
 {
     VkDescriptorPoolCreateInfo createInfo = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = flags,
         .maxSets = frameInFlightCount,
         .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
         .pPoolSizes = poolSizes.data(),
@@ -792,79 +1159,205 @@ inline void write_descriptor_sets(VkDevice device, const std::vector<VkWriteDesc
 }
 } // namespace Shader
 
-inline VkPipeline create_pipeline(VkDevice device, VkRenderPass renderPass, const char *shaderName, VkExtent2D extent,
-                                  VkPipelineLayout pipelineLayout)
+/**
+ * @brief check that the serialized cache has been produced by the same driver and device
+ *
+ */
+inline bool is_pipeline_cache_data_compatible(VkPhysicalDevice physicalDevice, const std::vector<char> &data)
 {
-    std::vector<char> vs;
-    if (!read_binary_file("shaders/" + std::string(shaderName) + ".vert.spv", vs))
-        return VK_NULL_HANDLE;
-    std::vector<char> fs;
-    if (!read_binary_file("shaders/" + std::string(shaderName) + ".frag.spv", fs))
-        return VK_NULL_HANDLE;
+    VkPipelineCacheHeaderVersionOne header;
+    if (data.size() < sizeof(header))
+        return false;
+    memcpy(&header, data.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 
-    VkShaderModule vsModule = Shader::create_shader_module(device, vs);
-    VkShaderModule fsModule = Shader::create_shader_module(device, fs);
+    return header.headerSize >= sizeof(header) && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+           memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+/**
+ * @brief Create a pipeline cache object, seeded with the file written by save_pipeline_cache if it is compatible
+ *
+ * @param device
+ * @param physicalDevice
+ * @param filename
+ * @return VkPipelineCache
+ */
+inline VkPipelineCache create_pipeline_cache(VkDevice device, VkPhysicalDevice physicalDevice,
+                                             const std::string &filename)
+{
+    std::vector<char> data;
+    std::ifstream file(filename, std::ios::binary);
+    if (file.is_open())
+    {
+        file.close();
+        if (!read_binary_file(filename, data) || !is_pipeline_cache_data_compatible(physicalDevice, data))
+        {
+            std::cerr << "Discarding incompatible pipeline cache : " << filename << std::endl;
+            data.clear();
+        }
+    }
 
-    VkPipelineShaderStageCreateInfo vsStageCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_VERTEX_BIT,
-        .module = vsModule,
-        .pName = "main",
-        // for shader constants values
-        .pSpecializationInfo = nullptr,
+    VkPipelineCacheCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.empty() ? nullptr : data.data(),
     };
 
-    VkPipelineShaderStageCreateInfo fsStageCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-        .module = fsModule,
-        .pName = "main",
-        .pSpecializationInfo = nullptr,
+    VkPipelineCache pipelineCache;
+    VkResult res = vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to create pipeline cache : " << res << std::endl;
+
+    return pipelineCache;
+}
+/**
+ * @brief serialize the pipeline cache so that the next launch does not compile the pipelines again
+ *
+ */
+inline bool save_pipeline_cache(VkDevice device, VkPipelineCache pipelineCache, const std::string &filename)
+{
+    size_t dataSize = 0;
+    VkResult res = vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr);
+    if (res != VK_SUCCESS)
+    {
+        std::cerr << "Failed to get pipeline cache data size : " << res << std::endl;
+        return false;
+    }
+
+    std::vector<char> data(dataSize);
+    res = vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data());
+    if (res != VK_SUCCESS)
+    {
+        std::cerr << "Failed to get pipeline cache data : " << res << std::endl;
+        return false;
+    }
+    data.resize(dataSize);
+
+    return write_binary_file(filename, data);
+}
+inline void destroy_pipeline_cache(VkDevice device, VkPipelineCache pipelineCache)
+{
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+}
+
+/**
+ * @brief acquire the module of a SPIR-V file from the module cache, or create it if there is no module cache
+ *
+ * @return VkShaderModule VK_NULL_HANDLE if the file could not be read
+ */
+inline VkShaderModule load_shader_module(VkDevice device, const std::string &path, Shader::ModuleCache *moduleCache)
+{
+    if (moduleCache)
+        return Shader::acquire_shader_module(*moduleCache, path);
+
+    std::vector<char> code;
+    if (!read_binary_file(path, code))
+        return VK_NULL_HANDLE;
+    return Shader::create_shader_module(device, code);
+}
+/**
+ * @brief without module cache, the modules only live for the pipeline creation
+ *
+ */
+inline void unload_shader_module(VkDevice device, VkShaderModule shaderModule, Shader::ModuleCache *moduleCache)
+{
+    if (moduleCache)
+        Shader::release_shader_module(*moduleCache, shaderModule);
+    else
+        Shader::destroy_shader_module(device, shaderModule);
+}
+
+/**
+ * @brief measured by create_pipeline, the driver values are only filled when the driver supports creation feedback
+ *
+ */
+struct CreationStats
+{
+    double hostMs = 0.0;
+    bool bDriverFeedback = false;
+    double driverMs = 0.0;
+    bool bCacheHit = false;
+};
+
+/**
+ * @brief Create a graphics pipeline object from its description
+ *
+ * @param device
+ * @param desc
+ * @param pipelineCache
+ * @param moduleCache
+ * @param stats optional, receives the creation time and whether the pipeline has been found in the pipeline cache
+ * @return VkPipeline VK_NULL_HANDLE if the creation failed
+ */
+inline VkPipeline create_pipeline(VkDevice device, const PipelineDesc &desc,
+                                  VkPipelineCache pipelineCache = VK_NULL_HANDLE,
+                                  Shader::ModuleCache *moduleCache = nullptr, CreationStats *stats = nullptr)
+{
+    auto releaseShaderModules = [device, moduleCache](const std::vector<VkShaderModule> &shaderModules) {
+        for (VkShaderModule shaderModule : shaderModules)
+            unload_shader_module(device, shaderModule, moduleCache);
     };
 
-    VkPipelineShaderStageCreateInfo shaderStagesCreateInfo[] = {vsStageCreateInfo, fsStageCreateInfo};
+    std::vector<VkShaderModule> shaderModules;
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStagesCreateInfo;
+    // not resized in the loop, the stages point in it
+    std::vector<VkSpecializationInfo> specializationInfos(desc.shaderStages.size());
+    for (const ShaderStageDesc &shaderStage : desc.shaderStages)
+    {
+        VkShaderModule shaderModule = load_shader_module(device, shaderStage.path, moduleCache);
+        if (shaderModule == VK_NULL_HANDLE)
+            break;
+
+        // shader constants values
+        VkSpecializationInfo &specializationInfo = specializationInfos[shaderModules.size()];
+        specializationInfo = {
+            .mapEntryCount = static_cast<uint32_t>(shaderStage.specializationEntries.size()),
+            .pMapEntries = shaderStage.specializationEntries.data(),
+            .dataSize = shaderStage.specializationData.size(),
+            .pData = shaderStage.specializationData.data(),
+        };
 
-    std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        shaderModules.emplace_back(shaderModule);
+        shaderStagesCreateInfo.emplace_back(VkPipelineShaderStageCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = shaderStage.stage,
+            .module = shaderModules.back(),
+            .pName = shaderStage.entryPoint.c_str(),
+            .pSpecializationInfo = shaderStage.specializationEntries.empty() ? nullptr : &specializationInfo,
+        });
+    }
+    if (shaderModules.size() != desc.shaderStages.size())
+    {
+        releaseShaderModules(shaderModules);
+        return VK_NULL_HANDLE;
+    }
 
     VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
-        .pDynamicStates = dynamicStates.data(),
+        .dynamicStateCount = static_cast<uint32_t>(desc.dynamicStates.size()),
+        .pDynamicStates = desc.dynamicStates.data(),
     };
 
-    // vertex (enabling the binding for the Vertex structure)
-    auto binding = VertexDesc::get_vertex_input_binding_description();
-    auto attribs = VertexDesc::get_vertex_input_attribute_description();
+    // vertex
     VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &binding,
-        .vertexAttributeDescriptionCount = static_cast<uint32_t>(attribs.size()),
-        .pVertexAttributeDescriptions = attribs.data(),
+        .vertexBindingDescriptionCount = static_cast<uint32_t>(desc.vertexBindings.size()),
+        .pVertexBindingDescriptions = desc.vertexBindings.data(),
+        .vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertexAttributes.size()),
+        .pVertexAttributeDescriptions = desc.vertexAttributes.data(),
     };
 
     // draw mode
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-        .primitiveRestartEnable = VK_FALSE,
-    };
-
-    // viewport
-    VkViewport viewport = {
-        .x = 0.f,
-        .y = 0.f,
-        .width = static_cast<float>(extent.width),
-        .height = static_cast<float>(extent.height),
-        .minDepth = 0.f,
-        .maxDepth = 1.f,
-    };
-
-    VkRect2D scissor = {
-        .offset = {0, 0},
-        .extent = extent,
+        .topology = desc.topology,
+        .primitiveRestartEnable = desc.primitiveRestartEnable,
     };
 
+    // viewport and scissor are dynamic states
     VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
         .viewportCount = 1,
@@ -876,20 +1369,20 @@ inline VkPipeline create_pipeline(VkDevice device, VkRenderPass renderPass, cons
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
         .depthClampEnable = VK_FALSE,
         .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode = VK_POLYGON_MODE_FILL,
-        .cullMode = VK_CULL_MODE_BACK_BIT,
-        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .polygonMode = desc.polygonMode,
+        .cullMode = desc.cullMode,
+        .frontFace = desc.frontFace,
         .depthBiasEnable = VK_FALSE,
         .depthBiasConstantFactor = 0.f,
         .depthBiasClamp = 0.f,
         .depthBiasSlopeFactor = 0.f,
-        .lineWidth = 1.f,
+        .lineWidth = desc.lineWidth,
     };
 
     // multisampling, anti-aliasing
     VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .rasterizationSamples = desc.rasterizationSamples,
         .sampleShadingEnable = VK_FALSE,
         .minSampleShading = 1.f,
         .pSampleMask = nullptr,
@@ -899,9 +1392,9 @@ inline VkPipeline create_pipeline(VkDevice device, VkRenderPass renderPass, cons
 
     VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-        .depthTestEnable = VK_TRUE,
-        .depthWriteEnable = VK_TRUE,
-        .depthCompareOp = VK_COMPARE_OP_LESS,
+        .depthTestEnable = desc.depthTestEnable,
+        .depthWriteEnable = desc.depthWriteEnable,
+        .depthCompareOp = desc.depthCompareOp,
         .depthBoundsTestEnable = VK_FALSE,
         .stencilTestEnable = VK_FALSE,
         .front = {},
@@ -911,32 +1404,27 @@ inline VkPipeline create_pipeline(VkDevice device, VkRenderPass renderPass, cons
     };
 
     // color blending
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = {
-        .blendEnable = VK_TRUE,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-        .colorBlendOp = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .alphaBlendOp = VK_BLEND_OP_ADD,
-        .colorWriteMask =
-            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-    };
-
     VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
         .logicOpEnable = VK_FALSE,
         .logicOp = VK_LOGIC_OP_COPY,
-        .attachmentCount = 1,
-        .pAttachments = &colorBlendAttachment,
+        .attachmentCount = static_cast<uint32_t>(desc.colorBlendAttachments.size()),
+        .pAttachments = desc.colorBlendAttachments.data(),
         .blendConstants = {0.f, 0.f, 0.f, 0.f},
     };
 
+    VkPipelineCreationFeedback creationFeedback = {};
+    VkPipelineCreationFeedbackCreateInfo creationFeedbackCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+        .pPipelineCreationFeedback = &creationFeedback,
+    };
+
     VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &creationFeedbackCreateInfo,
         // shader stage
-        .stageCount = 2,
-        .pStages = shaderStagesCreateInfo,
+        .stageCount = static_cast<uint32_t>(shaderStagesCreateInfo.size()),
+        .pStages = shaderStagesCreateInfo.data(),
         // fixed function stage
         .pVertexInputState = &vertexInputCreateInfo,
         .pInputAssemblyState = &inputAssemblyCreateInfo,
@@ -947,61 +1435,274 @@ inline VkPipeline create_pipeline(VkDevice device, VkRenderPass renderPass, cons
         .pColorBlendState = &colorBlendCreateInfo,
         .pDynamicState = &dynamicStateCreateInfo,
         // pipeline layout
-        .layout = pipelineLayout,
+        .layout = desc.pipelineLayout,
         // render pass
-        .renderPass = renderPass,
-        .subpass = 0,
+        .renderPass = desc.renderPass,
+        .subpass = desc.subpass,
         .basePipelineHandle = VK_NULL_HANDLE,
         .basePipelineIndex = -1,
     };
 
-    VkPipeline pipeline;
-    VkResult res = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    auto start = std::chrono::high_resolution_clock::now();
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult res = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+    releaseShaderModules(shaderModules);
+
     if (res != VK_SUCCESS)
+    {
         std::cerr << "Failed to create graphics pipeline : " << res << std::endl;
+        return VK_NULL_HANDLE;
+    }
 
-    Shader::destroy_shader_module(device, vsModule);
-    Shader::destroy_shader_module(device, fsModule);
+    if (stats)
+    {
+        // the driver fills the feedback when it supports it, otherwise only the host timing is meaningful
+        bool bDriverFeedback = creationFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT;
+        *stats = CreationStats{
+            .hostMs = elapsed.count(),
+            .bDriverFeedback = bDriverFeedback,
+            .driverMs = bDriverFeedback ? creationFeedback.duration / 1e6 : 0.0,
+            .bCacheHit = bDriverFeedback && (creationFeedback.flags &
+                                             VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT),
+        };
+    }
 
     return pipeline;
 }
-inline void destroy_pipeline(VkDevice device, VkPipeline pipeline)
+/**
+ * @brief Create a graphics pipeline object with the default states (see get_default_pipeline_desc)
+ *
+ */
+inline VkPipeline create_pipeline(VkDevice device, VkRenderPass renderPass, const char *shaderName, VkExtent2D extent,
+                                  VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache = VK_NULL_HANDLE)
 {
-    vkDestroyPipeline(device, pipeline, nullptr);
+    return create_pipeline(device, get_default_pipeline_desc(renderPass, shaderName, pipelineLayout), pipelineCache);
 }
-} // namespace Pipeline
-
-namespace Command
-{
-inline VkCommandPool create_command_pool(VkDevice device, uint32_t queueFamilyIndex, bool bTransient = false)
+/**
+ * @brief Create a compute pipeline object
+ *
+ * @param device
+ * @param shaderStage compute stage, with its specialization constants
+ * @param pipelineLayout
+ * @param pipelineCache
+ * @param moduleCache
+ * @return VkPipeline VK_NULL_HANDLE if the shader could not be loaded
+ */
+inline VkPipeline create_compute_pipeline(VkDevice device, const ShaderStageDesc &shaderStage,
+                                          VkPipelineLayout pipelineLayout,
+                                          VkPipelineCache pipelineCache = VK_NULL_HANDLE,
+                                          Shader::ModuleCache *moduleCache = nullptr)
 {
-    VkCommandPoolCreateFlags flags =
-        bTransient ? VK_COMMAND_POOL_CREATE_TRANSIENT_BIT : VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    VkCommandPoolCreateInfo createInfo = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .flags = flags,
-        .queueFamilyIndex = queueFamilyIndex,
+    VkShaderModule shaderModule = load_shader_module(device, shaderStage.path, moduleCache);
+    if (shaderModule == VK_NULL_HANDLE)
+        return VK_NULL_HANDLE;
+
+    VkSpecializationInfo specializationInfo = {
+        .mapEntryCount = static_cast<uint32_t>(shaderStage.specializationEntries.size()),
+        .pMapEntries = shaderStage.specializationEntries.data(),
+        .dataSize = shaderStage.specializationData.size(),
+        .pData = shaderStage.specializationData.data(),
+    };
+    VkComputePipelineCreateInfo pipelineCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage =
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = shaderModule,
+                .pName = shaderStage.entryPoint.c_str(),
+                .pSpecializationInfo = shaderStage.specializationEntries.empty() ? nullptr : &specializationInfo,
+            },
+        .layout = pipelineLayout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
     };
 
-    VkCommandPool commandPool;
-    VkResult res = vkCreateCommandPool(device, &createInfo, nullptr, &commandPool);
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult res = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
     if (res != VK_SUCCESS)
-        std::cerr << "Failed to create command pool : " << res << std::endl;
+        std::cerr << "Failed to create compute pipeline : " << res << std::endl;
 
-    return commandPool;
-}
+    unload_shader_module(device, shaderModule, moduleCache);
+
+    return pipeline;
+}
+inline void destroy_pipeline(VkDevice device, VkPipeline pipeline)
+{
+    vkDestroyPipeline(device, pipeline, nullptr);
+}
+
+/**
+ * @brief pipeline of a unique desc, shared by the registry and the callers holding it
+ *
+ */
+struct RegisteredPipeline
+{
+    // copied so that the entry outlives the caller's data
+    PipelineDesc desc;
+    std::string key;
+    std::atomic<VkPipeline> pipeline = VK_NULL_HANDLE;
+    // written before bReady is set, read it once the pipeline is ready
+    CreationStats stats;
+    // set once the creation has completed, the pipeline stays VK_NULL_HANDLE if it failed
+    std::atomic<bool> bReady = false;
+};
+
+/**
+ * @brief owns the pipelines, each unique desc is compiled once
+ *
+ * Not synchronized, the background compiler locks around its accesses.
+ *
+ */
+struct Registry
+{
+    VkDevice device;
+    VkPipelineCache pipelineCache;
+    Shader::ModuleCache *moduleCache;
+
+    // descs with the same hash, the keys tell them apart
+    std::map<uint64_t, std::vector<std::shared_ptr<RegisteredPipeline>>> pipelines;
+    uint32_t hitCount = 0;
+    uint32_t missCount = 0;
+};
+
+inline Registry create_registry(VkDevice device, VkPipelineCache pipelineCache = VK_NULL_HANDLE,
+                                Shader::ModuleCache *moduleCache = nullptr)
+{
+    return Registry{
+        .device = device,
+        .pipelineCache = pipelineCache,
+        .moduleCache = moduleCache,
+    };
+}
+/**
+ * @brief find the entry of the desc, or register a new one to compile with compile_pipeline
+ *
+ * An entry whose creation failed is replaced so that requesting its desc again retries the compilation.
+ *
+ * @param registry
+ * @param desc
+ * @param entry receives the entry of the desc
+ * @return bool true if the entry has just been registered and must be compiled
+ */
+inline bool find_or_register_pipeline(Registry &registry, const PipelineDesc &desc,
+                                      std::shared_ptr<RegisteredPipeline> &entry)
+{
+    std::string key = get_pipeline_desc_key(desc);
+    std::vector<std::shared_ptr<RegisteredPipeline>> &candidates = registry.pipelines[hash_pipeline_desc_key(key)];
+    for (auto candidate = candidates.begin(); candidate != candidates.end(); ++candidate)
+    {
+        if ((*candidate)->key != key)
+            continue;
+
+        bool bFailed = (*candidate)->bReady && (*candidate)->pipeline == VK_NULL_HANDLE;
+        if (!bFailed)
+        {
+            ++registry.hitCount;
+            entry = *candidate;
+            return false;
+        }
+
+        candidates.erase(candidate);
+        break;
+    }
+
+    ++registry.missCount;
+    entry = std::make_shared<RegisteredPipeline>();
+    entry->desc = desc;
+    entry->key = std::move(key);
+    candidates.emplace_back(entry);
+    return true;
+}
+/**
+ * @brief compile a registered entry, can run on any thread as it does not access the registry's map
+ *
+ */
+inline void compile_pipeline(const Registry &registry, RegisteredPipeline &entry)
+{
+    entry.pipeline =
+        create_pipeline(registry.device, entry.desc, registry.pipelineCache, registry.moduleCache, &entry.stats);
+    entry.bReady = true;
+}
+/**
+ * @brief Get the pipeline matching the desc, compiling it the first time
+ *
+ * @param registry
+ * @param desc
+ * @param stats optional, filled only when the pipeline is compiled by this call
+ * @return VkPipeline VK_NULL_HANDLE if the compilation failed, the next call retries it
+ */
+inline VkPipeline get_pipeline(Registry &registry, const PipelineDesc &desc, CreationStats *stats = nullptr)
+{
+    std::shared_ptr<RegisteredPipeline> entry;
+    if (find_or_register_pipeline(registry, desc, entry))
+    {
+        compile_pipeline(registry, *entry);
+        if (stats)
+            *stats = entry->stats;
+    }
+    return entry->pipeline;
+}
+/**
+ * @brief every entry must have completed its compilation
+ *
+ */
+inline void destroy_registry(Registry &registry)
+{
+    for (const auto &[hash, candidates] : registry.pipelines)
+    {
+        for (const std::shared_ptr<RegisteredPipeline> &entry : candidates)
+            destroy_pipeline(registry.device, entry->pipeline);
+    }
+    registry.pipelines.clear();
+}
+} // namespace Pipeline
+
+namespace Command
+{
+inline VkCommandPool create_command_pool(VkDevice device, uint32_t queueFamilyIndex, bool bTransient = false)
+{
+    VkCommandPoolCreateFlags flags =
+        bTransient ? VK_COMMAND_POOL_CREATE_TRANSIENT_BIT : VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    VkCommandPoolCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = flags,
+        .queueFamilyIndex = queueFamilyIndex,
+    };
+
+    VkCommandPool commandPool;
+    VkResult res = vkCreateCommandPool(device, &createInfo, nullptr, &commandPool);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to create command pool : " << res << std::endl;
+
+    return commandPool;
+}
 inline void destroy_command_pool(VkDevice device, VkCommandPool commandPool)
 {
     vkDestroyCommandPool(device, commandPool, nullptr);
 }
 
-inline std::vector<VkCommandBuffer> allocate_command_buffers(VkDevice device, VkCommandPool commandPool,
-                                                             uint32_t commandBufferCount)
+/**
+ * @brief reset every command buffer of the pool at once, cheaper than resetting them one by one
+ *
+ */
+inline void reset_command_pool(VkDevice device, VkCommandPool commandPool)
+{
+    VkResult res = vkResetCommandPool(device, commandPool, 0);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to reset command pool : " << res << std::endl;
+}
+
+inline std::vector<VkCommandBuffer> allocate_command_buffers(
+    VkDevice device, VkCommandPool commandPool, uint32_t commandBufferCount,
+    VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY)
 {
     VkCommandBufferAllocateInfo allocInfo = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
         .commandPool = commandPool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .level = level,
         .commandBufferCount = commandBufferCount,
     };
 
@@ -1013,6 +1714,48 @@ inline std::vector<VkCommandBuffer> allocate_command_buffers(VkDevice device, Vk
     return commandBuffer;
 }
 
+/**
+ * @brief command pool of a single thread handing out secondary command buffers, recycled when the pool is reset
+ *
+ */
+struct SecondaryCommandPool
+{
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> commandBuffers;
+    uint32_t usedCount = 0;
+};
+
+inline SecondaryCommandPool create_secondary_command_pool(VkDevice device, uint32_t queueFamilyIndex)
+{
+    return SecondaryCommandPool{
+        .commandPool = create_command_pool(device, queueFamilyIndex, true),
+    };
+}
+inline void destroy_secondary_command_pool(VkDevice device, SecondaryCommandPool &pool)
+{
+    destroy_command_pool(device, pool.commandPool);
+    pool.commandBuffers.clear();
+    pool.usedCount = 0;
+}
+/**
+ * @brief to call once the command buffers of the pool are no longer in use by the device
+ *
+ */
+inline void reset_secondary_command_pool(VkDevice device, SecondaryCommandPool &pool)
+{
+    reset_command_pool(device, pool.commandPool);
+    pool.usedCount = 0;
+}
+inline VkCommandBuffer get_secondary_command_buffer(VkDevice device, SecondaryCommandPool &pool)
+{
+    if (pool.usedCount == pool.commandBuffers.size())
+    {
+        pool.commandBuffers.emplace_back(
+            allocate_command_buffers(device, pool.commandPool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY)[0]);
+    }
+    return pool.commandBuffers[pool.usedCount++];
+}
+
 inline VkCommandBuffer command_buffer_begin_one_time_submit(VkDevice device, VkCommandPool commandPoolTransient)
 {
     VkCommandBufferAllocateInfo allocInfo = {
@@ -1050,6 +1793,176 @@ inline void command_buffer_end_one_time_submit(VkCommandBuffer commandBuffer, Vk
     vkQueueWaitIdle(queue);
     vkFreeCommandBuffers(device, commandPoolTransient, 1, &commandBuffer);
 }
+
+/**
+ * @brief accumulates the barriers and copies of many uploads to record them with as few commands as possible
+ *
+ * Commands are recorded in three phases : pre-copy barriers, copies, post-copy barriers. Each barrier phase becomes a
+ * single vkCmdPipelineBarrier and consecutive copies between the same resources a single copy command.
+ *
+ */
+struct RecordingContext
+{
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+    VkPipelineStageFlags preSrcStageMask = 0;
+    VkPipelineStageFlags preDstStageMask = 0;
+    std::vector<VkBufferMemoryBarrier> preBufferBarriers;
+    std::vector<VkImageMemoryBarrier> preImageBarriers;
+
+    std::vector<std::tuple<VkBuffer, VkBuffer, VkBufferCopy>> bufferCopies;
+    std::vector<std::tuple<VkBuffer, VkImage, VkBufferImageCopy>> imageCopies;
+
+    VkPipelineStageFlags postSrcStageMask = 0;
+    VkPipelineStageFlags postDstStageMask = 0;
+    std::vector<VkMemoryBarrier> postMemoryBarriers;
+    std::vector<VkBufferMemoryBarrier> postBufferBarriers;
+    std::vector<VkImageMemoryBarrier> postImageBarriers;
+};
+
+inline void begin_recording_context(RecordingContext &context, VkCommandBuffer commandBuffer)
+{
+    context = RecordingContext{.commandBuffer = commandBuffer};
+
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    VkResult res = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to begin recording context : " << res << std::endl;
+}
+inline RecordingContext begin_one_time_recording_context(VkDevice device, VkCommandPool commandPoolTransient)
+{
+    RecordingContext context;
+    context.commandBuffer = command_buffer_begin_one_time_submit(device, commandPoolTransient);
+    return context;
+}
+
+inline void record_pre_copy_barrier(RecordingContext &context, const VkBufferMemoryBarrier &barrier,
+                                    VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask)
+{
+    context.preSrcStageMask |= srcStageMask;
+    context.preDstStageMask |= dstStageMask;
+    context.preBufferBarriers.emplace_back(barrier);
+}
+inline void record_pre_copy_barrier(RecordingContext &context, const VkImageMemoryBarrier &barrier,
+                                    VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask)
+{
+    context.preSrcStageMask |= srcStageMask;
+    context.preDstStageMask |= dstStageMask;
+    context.preImageBarriers.emplace_back(barrier);
+}
+
+inline void record_copy(RecordingContext &context, VkBuffer srcBuffer, VkBuffer dstBuffer, const VkBufferCopy &region)
+{
+    context.bufferCopies.emplace_back(srcBuffer, dstBuffer, region);
+}
+inline void record_copy(RecordingContext &context, VkBuffer srcBuffer, VkImage dstImage,
+                        const VkBufferImageCopy &region)
+{
+    context.imageCopies.emplace_back(srcBuffer, dstImage, region);
+}
+
+inline void record_post_copy_barrier(RecordingContext &context, const VkMemoryBarrier &barrier,
+                                     VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask)
+{
+    context.postSrcStageMask |= srcStageMask;
+    context.postDstStageMask |= dstStageMask;
+    context.postMemoryBarriers.emplace_back(barrier);
+}
+inline void record_post_copy_barrier(RecordingContext &context, const VkBufferMemoryBarrier &barrier,
+                                     VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask)
+{
+    context.postSrcStageMask |= srcStageMask;
+    context.postDstStageMask |= dstStageMask;
+    context.postBufferBarriers.emplace_back(barrier);
+}
+inline void record_post_copy_barrier(RecordingContext &context, const VkImageMemoryBarrier &barrier,
+                                     VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask)
+{
+    context.postSrcStageMask |= srcStageMask;
+    context.postDstStageMask |= dstStageMask;
+    context.postImageBarriers.emplace_back(barrier);
+}
+
+/**
+ * @brief record the accumulated commands in the command buffer and clear them
+ *
+ */
+inline void flush_recording_context(RecordingContext &context)
+{
+    if (!context.preBufferBarriers.empty() || !context.preImageBarriers.empty())
+    {
+        vkCmdPipelineBarrier(context.commandBuffer, context.preSrcStageMask, context.preDstStageMask, 0, 0, nullptr,
+                             static_cast<uint32_t>(context.preBufferBarriers.size()), context.preBufferBarriers.data(),
+                             static_cast<uint32_t>(context.preImageBarriers.size()), context.preImageBarriers.data());
+    }
+
+    // consecutive copies between the same resources are merged into one command
+    std::vector<VkBufferCopy> bufferRegions;
+    for (size_t i = 0; i < context.bufferCopies.size(); ++i)
+    {
+        const auto &[srcBuffer, dstBuffer, region] = context.bufferCopies[i];
+        bufferRegions.emplace_back(region);
+        if (i + 1 == context.bufferCopies.size() || std::get<0>(context.bufferCopies[i + 1]) != srcBuffer ||
+            std::get<1>(context.bufferCopies[i + 1]) != dstBuffer)
+        {
+            vkCmdCopyBuffer(context.commandBuffer, srcBuffer, dstBuffer, static_cast<uint32_t>(bufferRegions.size()),
+                            bufferRegions.data());
+            bufferRegions.clear();
+        }
+    }
+    std::vector<VkBufferImageCopy> imageRegions;
+    for (size_t i = 0; i < context.imageCopies.size(); ++i)
+    {
+        const auto &[srcBuffer, dstImage, region] = context.imageCopies[i];
+        imageRegions.emplace_back(region);
+        if (i + 1 == context.imageCopies.size() || std::get<0>(context.imageCopies[i + 1]) != srcBuffer ||
+            std::get<1>(context.imageCopies[i + 1]) != dstImage)
+        {
+            vkCmdCopyBufferToImage(context.commandBuffer, srcBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   static_cast<uint32_t>(imageRegions.size()), imageRegions.data());
+            imageRegions.clear();
+        }
+    }
+
+    if (!context.postMemoryBarriers.empty() || !context.postBufferBarriers.empty() ||
+        !context.postImageBarriers.empty())
+    {
+        vkCmdPipelineBarrier(context.commandBuffer, context.postSrcStageMask, context.postDstStageMask, 0,
+                             static_cast<uint32_t>(context.postMemoryBarriers.size()),
+                             context.postMemoryBarriers.data(),
+                             static_cast<uint32_t>(context.postBufferBarriers.size()),
+                             context.postBufferBarriers.data(), static_cast<uint32_t>(context.postImageBarriers.size()),
+                             context.postImageBarriers.data());
+    }
+
+    context = RecordingContext{.commandBuffer = context.commandBuffer};
+}
+
+/**
+ * @brief record the accumulated commands and end the command buffer, submitting it is up to the caller
+ *
+ */
+inline void end_recording_context(RecordingContext &context)
+{
+    flush_recording_context(context);
+    VkResult res = vkEndCommandBuffer(context.commandBuffer);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to end recording context : " << res << std::endl;
+}
+/**
+ * @brief record the accumulated commands, then submit and wait once for all of them
+ *
+ */
+inline void end_one_time_recording_context(RecordingContext &context, VkDevice device, VkQueue queue,
+                                           VkCommandPool commandPoolTransient)
+{
+    flush_recording_context(context);
+    command_buffer_end_one_time_submit(context.commandBuffer, device, queue, commandPoolTransient);
+    context.commandBuffer = VK_NULL_HANDLE;
+}
 } // namespace Command
 
 namespace Parallel
@@ -1072,6 +1985,48 @@ inline void destroy_semaphore(VkDevice device, VkSemaphore semaphore)
     vkDestroySemaphore(device, semaphore, nullptr);
 }
 
+inline VkSemaphore create_timeline_semaphore(VkDevice device, uint64_t initialValue = 0)
+{
+    VkSemaphoreTypeCreateInfo typeCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = initialValue,
+    };
+    VkSemaphoreCreateInfo semaphoreCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &typeCreateInfo,
+    };
+
+    VkSemaphore semaphore;
+    VkResult res = vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphore);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to create timeline semaphore : " << res << std::endl;
+
+    return semaphore;
+}
+inline uint64_t get_timeline_semaphore_value(VkDevice device, VkSemaphore semaphore)
+{
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(device, semaphore, &value);
+    return value;
+}
+/**
+ * @brief block the calling thread until the timeline semaphore reaches value
+ *
+ * @return bool false on timeout
+ */
+inline bool wait_timeline_semaphore(VkDevice device, VkSemaphore semaphore, uint64_t value,
+                                    uint64_t timeout = std::numeric_limits<uint64_t>::max())
+{
+    VkSemaphoreWaitInfo waitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &semaphore,
+        .pValues = &value,
+    };
+    return vkWaitSemaphores(device, &waitInfo, timeout) == VK_SUCCESS;
+}
+
 inline VkFence create_fence(VkDevice device)
 {
     VkFenceCreateInfo fenceCreateInfo = {
@@ -1103,10 +2058,14 @@ inline VkDeviceMemory allocate_memory(VkDevice device, VkDeviceSize requiredSize
         .memoryTypeIndex = memoryTypeIndex,
     };
 
-    VkDeviceMemory memory;
+    // the handle is not guaranteed to be written on failure
+    VkDeviceMemory memory = VK_NULL_HANDLE;
     VkResult res = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
     if (res != VK_SUCCESS)
+    {
         std::cerr << "Failed to allocate memory : " << res << std::endl;
+        return VK_NULL_HANDLE;
+    }
 
     return memory;
 }
@@ -1115,112 +2074,1079 @@ inline void free_memory(VkDevice device, VkDeviceMemory memory)
     vkFreeMemory(device, memory, nullptr);
 }
 
-inline void copy_data_to_memory(VkDevice device, VkDeviceMemory memory, const void *srcData, size_t size)
+/**
+ * @brief large VkDeviceMemory allocation sub-allocated with a free list
+ *
+ */
+struct Block
 {
-    // filling the VBO (bind and unbind CPU accessible memory)
-    void *data;
-    vkMapMemory(device, memory, 0, size, 0, &data);
-    // TODO : flush memory
-    memcpy(data, srcData, size);
-    // TODO : invalidate memory before reading in the pipeline
-    vkUnmapMemory(device, memory);
-}
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeIndex = 0;
+    VkMemoryPropertyFlags propertyFlags = 0;
+    // persistently mapped pointer if the memory type is host visible
+    void *mapped = nullptr;
+
+    // offset -> size, adjacent free regions are always merged
+    std::map<VkDeviceSize, VkDeviceSize> freeRegions;
+    // offset -> (size, is linear resource)
+    std::map<VkDeviceSize, std::pair<VkDeviceSize, bool>> usedRegions;
+};
 
-inline void transfer_buffer(VkDevice device, VkBuffer srcBuffer, VkBuffer dstBuffer, size_t size,
-                            VkCommandPool commandPoolTransient, VkQueue queue)
+/**
+ * @brief sub-allocation handle (block plus offset)
+ *
+ */
+struct Allocation
 {
-    VkCommandBuffer commandBuffer = Command::command_buffer_begin_one_time_submit(device, commandPoolTransient);
-    VkBufferCopy copyRegion = {
-        .size = size,
-    };
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-    Command::command_buffer_end_one_time_submit(commandBuffer, device, queue, commandPoolTransient);
-}
+    Block *block = nullptr;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // mapped pointer at offset, nullptr if the memory is not host visible
+    void *mapped = nullptr;
+};
 
-namespace Buffer
+struct Statistics
 {
+    uint32_t blockCount = 0;
+    uint32_t allocationCount = 0;
+    VkDeviceSize reservedBytes = 0;
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize freeBytes = 0;
+    uint32_t freeRegionCount = 0;
+    VkDeviceSize largestFreeRegion = 0;
+    // 0 when the free space of each block is contiguous, tends to 1 as it gets scattered
+    float fragmentation = 0.f;
+};
+
 /**
- * @brief Create a buffer object
+ * @brief block based sub-allocator, one list of blocks per memory type index
  *
- * @param device
- * @param size
- * @param usage
- * @return VkBuffer
  */
-inline VkBuffer create_buffer(VkDevice device, size_t size, VkBufferUsageFlags usage)
+struct Allocator
 {
-    VkBufferCreateInfo createInfo = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .flags = 0,
-        .size = size,
-        .usage = usage,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-    };
-
-    VkBuffer buffer;
-    VkResult res = vkCreateBuffer(device, &createInfo, nullptr, &buffer);
-    if (res != VK_SUCCESS)
-        std::cerr << "Failed to create buffer : " << res << std::endl;
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDeviceSize blockSize = 0;
+    VkDeviceSize bufferImageGranularity = 1;
+    VkDeviceSize nonCoherentAtomSize = 1;
+    uint32_t maxMemoryAllocationCount = 0;
+    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+
+    std::map<uint32_t, std::vector<std::unique_ptr<Block>>> blocks;
+};
 
-    return buffer;
-}
-inline void destroy_buffer(VkDevice device, VkBuffer buffer)
+inline VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
 {
-    vkDestroyBuffer(device, buffer, nullptr);
+    return alignment > 1 ? (value + alignment - 1) & ~(alignment - 1) : value;
 }
 
-inline void bind_memory_to_buffer(VkDevice device, VkBuffer buffer, VkDeviceMemory memory)
+/**
+ * do the last byte of resource A and the first byte of resource B share a page
+ */
+inline bool is_on_same_page(VkDeviceSize lastByteA, VkDeviceSize firstByteB, VkDeviceSize pageSize)
 {
-    vkBindBufferMemory(device, buffer, memory, 0);
+    return (lastByteA & ~(pageSize - 1)) == (firstByteB & ~(pageSize - 1));
 }
 
-inline std::pair<VkBuffer, VkDeviceMemory> create_allocated_buffer(
-    VkDevice device, VkPhysicalDevice physicalDevice, size_t size, VkBufferUsageFlags usage,
-    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+inline Allocator create_allocator(VkDevice device, VkPhysicalDevice physicalDevice,
+                                  VkDeviceSize blockSize = 64ull * 1024ull * 1024ull)
 {
-    VkBuffer buffer = create_buffer(device, size, usage);
-    VkMemoryRequirements memReq;
-    vkGetBufferMemoryRequirements(device, buffer, &memReq);
-    std::optional<uint32_t> memoryTypeIndex =
-        Device::Memory::find_memory_type_index(physicalDevice, memReq, properties);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 
-    VkDeviceMemory memory = allocate_memory(device, memReq.size, memoryTypeIndex.value());
-    bind_memory_to_buffer(device, buffer, memory);
+    Allocator allocator;
+    allocator.device = device;
+    allocator.physicalDevice = physicalDevice;
+    allocator.blockSize = blockSize;
+    allocator.bufferImageGranularity = properties.limits.bufferImageGranularity;
+    allocator.nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+    allocator.maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &allocator.memoryProperties);
 
-    return {buffer, memory};
+    return allocator;
 }
 
 /**
- * @brief Create a optimal buffer from data object by using a staging buffer
+ * @brief size of the blocks shared by the resources of a memory type, do not reserve too much of small heaps
  *
- * @param device
- * @param physicalDevice
+ */
+inline VkDeviceSize get_block_size(const Allocator &allocator, uint32_t memoryTypeIndex)
+{
+    const VkMemoryType &memoryType = allocator.memoryProperties.memoryTypes[memoryTypeIndex];
+    VkDeviceSize heapSize = allocator.memoryProperties.memoryHeaps[memoryType.heapIndex].size;
+    return (std::min)(allocator.blockSize, heapSize / 8);
+}
+inline Block *create_block(Allocator &allocator, uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+    uint32_t blockCount = 0;
+    for (const auto &[typeIndex, typeBlocks] : allocator.blocks)
+        blockCount += static_cast<uint32_t>(typeBlocks.size());
+    if (blockCount >= allocator.maxMemoryAllocationCount)
+    {
+        std::cerr << "Failed to create memory block : maxMemoryAllocationCount reached" << std::endl;
+        return nullptr;
+    }
+
+    auto block = std::make_unique<Block>();
+    block->memory = allocate_memory(allocator.device, size, memoryTypeIndex);
+    if (block->memory == VK_NULL_HANDLE)
+        return nullptr;
+
+    block->size = size;
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->propertyFlags = allocator.memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    block->freeRegions[0] = size;
+
+    // a VkDeviceMemory can only be mapped once, keep host visible blocks mapped for their whole lifetime
+    if (block->propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        VkResult res = vkMapMemory(allocator.device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped);
+        if (res != VK_SUCCESS)
+            std::cerr << "Failed to map memory block : " << res << std::endl;
+    }
+
+    Block *ptr = block.get();
+    allocator.blocks[memoryTypeIndex].emplace_back(std::move(block));
+    return ptr;
+}
+inline void destroy_block(Allocator &allocator, Block *block)
+{
+    if (block->mapped)
+        vkUnmapMemory(allocator.device, block->memory);
+    free_memory(allocator.device, block->memory);
+
+    auto &typeBlocks = allocator.blocks[block->memoryTypeIndex];
+    typeBlocks.erase(std::find_if(typeBlocks.begin(), typeBlocks.end(),
+                                  [block](const std::unique_ptr<Block> &b) { return b.get() == block; }));
+}
+
+/**
+ * @brief first fit placement respecting the alignment and the bufferImageGranularity
+ *
+ * @return std::optional<VkDeviceSize> offset of the new sub-allocation
+ */
+inline std::optional<VkDeviceSize> allocate_in_block(Block &block, VkDeviceSize size, VkDeviceSize alignment,
+                                                     bool bLinear, VkDeviceSize granularity)
+{
+    for (auto it = block.freeRegions.begin(); it != block.freeRegions.end(); ++it)
+    {
+        VkDeviceSize regionBegin = it->first;
+        VkDeviceSize regionEnd = it->first + it->second;
+        VkDeviceSize offset = align_up(regionBegin, alignment);
+
+        // linear and non-linear resources must not share a page of bufferImageGranularity
+        auto prev = block.usedRegions.lower_bound(regionBegin);
+        if (prev != block.usedRegions.begin())
+        {
+            --prev;
+            VkDeviceSize prevLastByte = prev->first + prev->second.first - 1;
+            if (prev->second.second != bLinear && is_on_same_page(prevLastByte, offset, granularity))
+                offset = align_up(offset, granularity);
+        }
+
+        if (offset + size > regionEnd)
+            continue;
+
+        auto next = block.usedRegions.lower_bound(regionEnd);
+        if (next != block.usedRegions.end() && next->second.second != bLinear &&
+            is_on_same_page(offset + size - 1, next->first, granularity))
+            continue;
+
+        // split the free region, alignment padding stays free
+        block.freeRegions.erase(it);
+        if (offset > regionBegin)
+            block.freeRegions[regionBegin] = offset - regionBegin;
+        if (regionEnd > offset + size)
+            block.freeRegions[offset + size] = regionEnd - (offset + size);
+
+        block.usedRegions[offset] = {size, bLinear};
+        return std::optional<VkDeviceSize>(offset);
+    }
+
+    return std::optional<VkDeviceSize>();
+}
+
+/**
+ * @brief sub-allocate memory for a resource
+ *
+ * @param allocator
+ * @param requirements
+ * @param properties
+ * @param bLinear buffers and linear images, opposed to optimal tiling images
+ * @return Allocation invalid (null block) on failure
+ */
+inline Allocation allocate(Allocator &allocator, const VkMemoryRequirements &requirements,
+                           VkMemoryPropertyFlags properties, bool bLinear)
+{
+    std::optional<uint32_t> memoryTypeIndex =
+        Device::Memory::find_memory_type_index(allocator.physicalDevice, requirements, properties);
+    if (!memoryTypeIndex.has_value())
+        return Allocation{};
+
+    VkDeviceSize blockSize = get_block_size(allocator, memoryTypeIndex.value());
+
+    Block *block = nullptr;
+    std::optional<VkDeviceSize> offset;
+    for (const std::unique_ptr<Block> &b : allocator.blocks[memoryTypeIndex.value()])
+    {
+        offset = allocate_in_block(*b, requirements.size, requirements.alignment, bLinear,
+                                   allocator.bufferImageGranularity);
+        if (offset.has_value())
+        {
+            block = b.get();
+            break;
+        }
+    }
+
+    if (!block)
+    {
+        // big resources get their own dedicated block
+        VkDeviceSize newBlockSize = requirements.size > blockSize / 2 ? requirements.size : blockSize;
+        block = create_block(allocator, memoryTypeIndex.value(), newBlockSize);
+        if (!block)
+            return Allocation{};
+        offset = allocate_in_block(*block, requirements.size, requirements.alignment, bLinear,
+                                   allocator.bufferImageGranularity);
+    }
+
+    return Allocation{
+        .block = block,
+        .memory = block->memory,
+        .offset = offset.value(),
+        .size = requirements.size,
+        .mapped = block->mapped ? static_cast<char *>(block->mapped) + offset.value() : nullptr,
+    };
+}
+inline void free_memory(Allocator &allocator, const Allocation &allocation)
+{
+    Block *block = allocation.block;
+    if (!block)
+        return;
+
+    auto used = block->usedRegions.find(allocation.offset);
+    if (used == block->usedRegions.end())
+    {
+        std::cerr << "Failed to free memory : unknown allocation" << std::endl;
+        return;
+    }
+    VkDeviceSize regionBegin = used->first;
+    VkDeviceSize regionEnd = used->first + used->second.first;
+    block->usedRegions.erase(used);
+
+    // merge with the neighbouring free regions
+    auto next = block->freeRegions.find(regionEnd);
+    if (next != block->freeRegions.end())
+    {
+        regionEnd += next->second;
+        block->freeRegions.erase(next);
+    }
+    auto prev = block->freeRegions.lower_bound(regionBegin);
+    if (prev != block->freeRegions.begin())
+    {
+        --prev;
+        if (prev->first + prev->second == regionBegin)
+        {
+            regionBegin = prev->first;
+            block->freeRegions.erase(prev);
+        }
+    }
+    block->freeRegions[regionBegin] = regionEnd - regionBegin;
+
+    // keep one empty block per memory type to avoid reallocating on the next resource, dedicated blocks are released
+    bool bDedicated = block->size != get_block_size(allocator, block->memoryTypeIndex);
+    if (block->usedRegions.empty() && (bDedicated || allocator.blocks[block->memoryTypeIndex].size() > 1))
+        destroy_block(allocator, block);
+}
+
+inline void destroy_allocator(Allocator &allocator)
+{
+    for (auto &[memoryTypeIndex, typeBlocks] : allocator.blocks)
+    {
+        for (std::unique_ptr<Block> &block : typeBlocks)
+        {
+            if (!block->usedRegions.empty())
+                std::cerr << "Destroying memory block with " << block->usedRegions.size() << " live allocations"
+                          << std::endl;
+            if (block->mapped)
+                vkUnmapMemory(allocator.device, block->memory);
+            free_memory(allocator.device, block->memory);
+        }
+    }
+    allocator.blocks.clear();
+}
+
+/**
+ * @brief make host writes visible to the device for non coherent memory
+ *
+ */
+inline void flush_allocation(const Allocator &allocator, const Allocation &allocation, VkDeviceSize offset,
+                             VkDeviceSize size)
+{
+    if (!allocation.block || (allocation.block->propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        return;
+
+    VkDeviceSize begin = allocation.offset + offset;
+    VkDeviceSize alignedBegin = begin & ~(allocator.nonCoherentAtomSize - 1);
+    VkDeviceSize alignedEnd = (std::min)(align_up(begin + size, allocator.nonCoherentAtomSize), allocation.block->size);
+    VkMappedMemoryRange range = {
+        .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        .memory = allocation.memory,
+        .offset = alignedBegin,
+        .size = alignedEnd - alignedBegin,
+    };
+    vkFlushMappedMemoryRanges(allocator.device, 1, &range);
+}
+/**
+ * @brief make device writes visible to the host for non coherent memory
+ *
+ */
+inline void invalidate_allocation(const Allocator &allocator, const Allocation &allocation, VkDeviceSize offset,
+                                  VkDeviceSize size)
+{
+    if (!allocation.block || (allocation.block->propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        return;
+
+    VkDeviceSize begin = allocation.offset + offset;
+    VkDeviceSize alignedBegin = begin & ~(allocator.nonCoherentAtomSize - 1);
+    VkDeviceSize alignedEnd = (std::min)(align_up(begin + size, allocator.nonCoherentAtomSize), allocation.block->size);
+    VkMappedMemoryRange range = {
+        .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        .memory = allocation.memory,
+        .offset = alignedBegin,
+        .size = alignedEnd - alignedBegin,
+    };
+    vkInvalidateMappedMemoryRanges(allocator.device, 1, &range);
+}
+
+inline Statistics get_statistics(const Allocator &allocator)
+{
+    Statistics stats;
+    double fragmentationSum = 0.0;
+    for (const auto &[memoryTypeIndex, typeBlocks] : allocator.blocks)
+    {
+        for (const std::unique_ptr<Block> &block : typeBlocks)
+        {
+            ++stats.blockCount;
+            stats.allocationCount += static_cast<uint32_t>(block->usedRegions.size());
+            stats.reservedBytes += block->size;
+            for (const auto &[offset, region] : block->usedRegions)
+                stats.usedBytes += region.first;
+
+            VkDeviceSize blockFreeBytes = 0;
+            VkDeviceSize blockLargestFreeRegion = 0;
+            for (const auto &[offset, size] : block->freeRegions)
+            {
+                blockFreeBytes += size;
+                blockLargestFreeRegion = (std::max)(blockLargestFreeRegion, size);
+            }
+            stats.freeBytes += blockFreeBytes;
+            stats.freeRegionCount += static_cast<uint32_t>(block->freeRegions.size());
+            stats.largestFreeRegion = (std::max)(stats.largestFreeRegion, blockLargestFreeRegion);
+            if (blockFreeBytes > 0)
+                fragmentationSum += 1.0 - static_cast<double>(blockLargestFreeRegion) / blockFreeBytes;
+        }
+    }
+    if (stats.blockCount > 0)
+        stats.fragmentation = static_cast<float>(fragmentationSum / stats.blockCount);
+
+    return stats;
+}
+inline void print_statistics(const Allocator &allocator)
+{
+    Statistics stats = get_statistics(allocator);
+    std::cout << "memory blocks : " << stats.blockCount << " (" << stats.reservedBytes << " bytes reserved)\n"
+              << "\tallocations : " << stats.allocationCount << " (" << stats.usedBytes << " bytes used)\n"
+              << "\tfree regions : " << stats.freeRegionCount << " (" << stats.freeBytes << " bytes, largest "
+              << stats.largestFreeRegion << ")\n"
+              << "\tfragmentation : " << stats.fragmentation << '\n';
+}
+
+inline void copy_data_to_memory(const Allocator &allocator, const Allocation &allocation, const void *srcData,
+                                size_t size)
+{
+    if (!allocation.mapped)
+    {
+        std::cerr << "Failed to copy data to memory : allocation is not host visible" << std::endl;
+        return;
+    }
+    memcpy(allocation.mapped, srcData, size);
+    flush_allocation(allocator, allocation, 0, size);
+}
+
+inline void copy_data_to_memory(VkDevice device, VkDeviceMemory memory, const void *srcData, size_t size)
+{
+    // filling the VBO (bind and unbind CPU accessible memory)
+    void *data;
+    vkMapMemory(device, memory, 0, size, 0, &data);
+    // TODO : flush memory
+    memcpy(data, srcData, size);
+    // TODO : invalidate memory before reading in the pipeline
+    vkUnmapMemory(device, memory);
+}
+
+inline void transfer_buffer(VkDevice device, VkBuffer srcBuffer, VkBuffer dstBuffer, size_t size,
+                            VkCommandPool commandPoolTransient, VkQueue queue)
+{
+    VkCommandBuffer commandBuffer = Command::command_buffer_begin_one_time_submit(device, commandPoolTransient);
+    VkBufferCopy copyRegion = {
+        .size = size,
+    };
+    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    Command::command_buffer_end_one_time_submit(commandBuffer, device, queue, commandPoolTransient);
+}
+
+namespace Buffer
+{
+/**
+ * @brief Create a buffer object
+ *
+ * @param device
  * @param size
- * @param data
- * @param commandPoolTransient
- * @param graphicsQueue
- * @return std::pair<VkBuffer, VkDeviceMemory>
+ * @param usage
+ * @param concurrentFamilyIndices queue families accessing the buffer without ownership transfers, empty for an
+ * exclusive buffer
+ * @return VkBuffer
+ */
+inline VkBuffer create_buffer(VkDevice device, size_t size, VkBufferUsageFlags usage,
+                              const std::vector<uint32_t> &concurrentFamilyIndices = {})
+{
+    bool bConcurrent = concurrentFamilyIndices.size() > 1;
+    VkBufferCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .flags = 0,
+        .size = size,
+        .usage = usage,
+        .sharingMode = bConcurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = bConcurrent ? static_cast<uint32_t>(concurrentFamilyIndices.size()) : 0u,
+        .pQueueFamilyIndices = bConcurrent ? concurrentFamilyIndices.data() : nullptr,
+    };
+
+    VkBuffer buffer;
+    VkResult res = vkCreateBuffer(device, &createInfo, nullptr, &buffer);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to create buffer : " << res << std::endl;
+
+    return buffer;
+}
+inline void destroy_buffer(VkDevice device, VkBuffer buffer)
+{
+    vkDestroyBuffer(device, buffer, nullptr);
+}
+
+inline void bind_memory_to_buffer(VkDevice device, VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize offset = 0)
+{
+    vkBindBufferMemory(device, buffer, memory, offset);
+}
+
+inline std::pair<VkBuffer, Allocation> create_allocated_buffer(
+    VkDevice device, Allocator &allocator, size_t size, VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    const std::vector<uint32_t> &concurrentFamilyIndices = {})
+{
+    VkBuffer buffer = create_buffer(device, size, usage, concurrentFamilyIndices);
+    VkMemoryRequirements memReq;
+    vkGetBufferMemoryRequirements(device, buffer, &memReq);
+
+    Allocation allocation = allocate(allocator, memReq, properties, true);
+    if (allocation.memory == VK_NULL_HANDLE)
+    {
+        std::cerr << "Failed to allocate buffer memory : " << memReq.size << " bytes" << std::endl;
+        destroy_buffer(device, buffer);
+        return {VK_NULL_HANDLE, Allocation{}};
+    }
+    bind_memory_to_buffer(device, buffer, allocation.memory, allocation.offset);
+
+    return {buffer, allocation};
+}
+} // namespace Buffer
+
+namespace Staging
+{
+/**
+ * @brief uploads recorded together, the ring space before end is released once the timeline reaches timelineValue
+ *
+ */
+struct Batch
+{
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    Command::RecordingContext context;
+    // queue family ownership acquire, only used with a dedicated transfer queue
+    VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+    std::vector<VkBufferMemoryBarrier> acquireBufferBarriers;
+    std::vector<VkImageMemoryBarrier> acquireImageBarriers;
+    uint64_t timelineValue = 0;
+    VkDeviceSize end = 0;
+    uint32_t copyCount = 0;
+
+    // uploads too big for the ring, destroyed with the batch
+    std::vector<std::pair<VkBuffer, Allocation>> dedicatedBuffers;
+};
+
+/**
+ * @brief persistently mapped staging ring buffer, uploads are recorded into batches submitted on flush
+ *
+ * With a dedicated transfer queue, the copies run on the transfer queue and the resources are handed over to the
+ * graphics queue family. Completion is tracked with a timeline semaphore so that nothing blocks the CPU.
+ *
+ */
+struct Ring
+{
+    VkDevice device = VK_NULL_HANDLE;
+    Allocator *allocator = nullptr;
+
+    VkQueue graphicsQueue = VK_NULL_HANDLE;
+    uint32_t graphicsFamilyIndex = 0;
+    VkQueue transferQueue = VK_NULL_HANDLE;
+    uint32_t transferFamilyIndex = 0;
+    VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+    VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
+
+    // signaled by the transfer queue, waited on by the ownership acquire
+    VkSemaphore transferSemaphore = VK_NULL_HANDLE;
+    // signaled once the uploads of a batch are usable by the graphics queue
+    VkSemaphore uploadSemaphore = VK_NULL_HANDLE;
+    uint64_t submittedValue = 0;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    Allocation allocation;
+    VkDeviceSize size = 0;
+    // next write offset
+    VkDeviceSize head = 0;
+    // first byte still read by the device
+    VkDeviceSize tail = 0;
+
+    std::optional<Batch> recording;
+    std::deque<Batch> inFlight;
+    // recycled command buffers
+    std::vector<Batch> freeBatches;
+};
+
+inline bool has_dedicated_transfer_queue(const Ring &ring)
+{
+    return ring.transferFamilyIndex != ring.graphicsFamilyIndex;
+}
+
+/**
+ * @brief Create a staging ring object
+ *
+ * @param device
+ * @param allocator
+ * @param graphicsQueue queue consuming the uploaded resources
+ * @param graphicsFamilyIndex
+ * @param transferQueue queue running the copies, can be the graphics queue
+ * @param transferFamilyIndex
+ * @param size
+ * @return Ring an empty ring (VK_NULL_HANDLE buffer) if the staging buffer could not be created and mapped
+ */
+inline Ring create_staging_ring(VkDevice device, Allocator &allocator, VkQueue graphicsQueue,
+                                uint32_t graphicsFamilyIndex, VkQueue transferQueue, uint32_t transferFamilyIndex,
+                                VkDeviceSize size = 32ull * 1024ull * 1024ull)
+{
+    auto buffer = Buffer::create_allocated_buffer(device, allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    if (buffer.first == VK_NULL_HANDLE || buffer.second.mapped == nullptr)
+    {
+        std::cerr << "Failed to create staging ring buffer of " << size << " bytes" << std::endl;
+        if (buffer.first != VK_NULL_HANDLE)
+        {
+            free_memory(allocator, buffer.second);
+            Buffer::destroy_buffer(device, buffer.first);
+        }
+        return Ring{};
+    }
+
+    Ring ring;
+    ring.device = device;
+    ring.allocator = &allocator;
+    ring.graphicsQueue = graphicsQueue;
+    ring.graphicsFamilyIndex = graphicsFamilyIndex;
+    ring.transferQueue = transferQueue;
+    ring.transferFamilyIndex = transferFamilyIndex;
+    ring.transferCommandPool = Command::create_command_pool(device, transferFamilyIndex);
+    if (has_dedicated_transfer_queue(ring))
+    {
+        ring.graphicsCommandPool = Command::create_command_pool(device, graphicsFamilyIndex);
+        ring.transferSemaphore = Parallel::create_timeline_semaphore(device);
+    }
+    ring.uploadSemaphore = Parallel::create_timeline_semaphore(device);
+    ring.size = size;
+    ring.buffer = buffer.first;
+    ring.allocation = buffer.second;
+
+    return ring;
+}
+
+/**
+ * @brief have the uploads of a flush become usable by the graphics queue
+ *
+ */
+inline bool is_upload_complete(const Ring &ring, uint64_t timelineValue)
+{
+    if (ring.buffer == VK_NULL_HANDLE)
+        return true;
+    return Parallel::get_timeline_semaphore_value(ring.device, ring.uploadSemaphore) >= timelineValue;
+}
+
+/**
+ * @brief release the ring space and the dedicated buffers of the completed batches
+ *
+ * @param ring
+ * @param bWait wait for the oldest batch even if it is not complete yet
+ */
+inline void retire_batches(Ring &ring, bool bWait = false)
+{
+    if (ring.buffer == VK_NULL_HANDLE)
+        return;
+
+    uint64_t completedValue = Parallel::get_timeline_semaphore_value(ring.device, ring.uploadSemaphore);
+    while (!ring.inFlight.empty())
+    {
+        Batch &batch = ring.inFlight.front();
+        if (completedValue < batch.timelineValue)
+        {
+            if (!bWait)
+                break;
+            Parallel::wait_timeline_semaphore(ring.device, ring.uploadSemaphore, batch.timelineValue);
+            bWait = false;
+        }
+
+        ring.tail = batch.end;
+        for (auto &[buffer, allocation] : batch.dedicatedBuffers)
+        {
+            free_memory(*ring.allocator, allocation);
+            Buffer::destroy_buffer(ring.device, buffer);
+        }
+        batch.dedicatedBuffers.clear();
+        batch.acquireBufferBarriers.clear();
+        batch.acquireImageBarriers.clear();
+        batch.copyCount = 0;
+
+        ring.freeBatches.emplace_back(std::move(batch));
+        ring.inFlight.pop_front();
+    }
+
+    // nothing left to read, restart from the beginning to limit wrapping
+    if (ring.inFlight.empty() && !ring.recording.has_value())
+    {
+        ring.head = 0;
+        ring.tail = 0;
+    }
+}
+
+/**
+ * @brief submit the uploads recorded so far without waiting for them
+ *
+ * With a single queue, every upload is made visible to later commands with one global barrier. With a dedicated
+ * transfer queue, the ownership of every uploaded resource is released by the transfer queue and acquired by the
+ * graphics queue in a second submission waiting on the transfer on the device.
+ *
+ * @return uint64_t upload timeline value to wait for before using the resources from another queue or the host
+ */
+inline uint64_t flush(Ring &ring)
+{
+    if (!ring.recording.has_value())
+        return ring.submittedValue;
+
+    Batch batch = std::move(ring.recording.value());
+    ring.recording.reset();
+    batch.end = ring.head;
+    batch.timelineValue = ++ring.submittedValue;
+
+    // non coherent memory needs the written range to be flushed before the submission
+    flush_allocation(*ring.allocator, ring.allocation, 0, ring.size);
+
+    if (!has_dedicated_transfer_queue(ring))
+    {
+        VkMemoryBarrier barrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                             VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+        };
+        Command::record_post_copy_barrier(batch.context, barrier, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        Command::end_recording_context(batch.context);
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &batch.timelineValue,
+        };
+        VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = &timelineInfo,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &batch.commandBuffer,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &ring.uploadSemaphore,
+        };
+        VkResult res = vkQueueSubmit(ring.transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        if (res != VK_SUCCESS)
+            std::cerr << "Failed to submit staging batch : " << res << std::endl;
+
+        ring.inFlight.emplace_back(std::move(batch));
+        return ring.submittedValue;
+    }
+
+    // the ownership release barriers were recorded as post-copy barriers
+    Command::end_recording_context(batch.context);
+
+    VkTimelineSemaphoreSubmitInfo transferTimelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &batch.timelineValue,
+    };
+    VkSubmitInfo transferSubmitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &transferTimelineInfo,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &batch.commandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &ring.transferSemaphore,
+    };
+    VkResult res = vkQueueSubmit(ring.transferQueue, 1, &transferSubmitInfo, VK_NULL_HANDLE);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to submit staging batch : " << res << std::endl;
+
+    // matching acquire on the graphics queue
+    if (batch.acquireCommandBuffer == VK_NULL_HANDLE)
+        batch.acquireCommandBuffer = Command::allocate_command_buffers(ring.device, ring.graphicsCommandPool, 1)[0];
+    else
+        vkResetCommandBuffer(batch.acquireCommandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    vkBeginCommandBuffer(batch.acquireCommandBuffer, &beginInfo);
+    vkCmdPipelineBarrier(batch.acquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+                         static_cast<uint32_t>(batch.acquireBufferBarriers.size()), batch.acquireBufferBarriers.data(),
+                         static_cast<uint32_t>(batch.acquireImageBarriers.size()), batch.acquireImageBarriers.data());
+    vkEndCommandBuffer(batch.acquireCommandBuffer);
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkTimelineSemaphoreSubmitInfo acquireTimelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .waitSemaphoreValueCount = 1,
+        .pWaitSemaphoreValues = &batch.timelineValue,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &batch.timelineValue,
+    };
+    VkSubmitInfo acquireSubmitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &acquireTimelineInfo,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &ring.transferSemaphore,
+        .pWaitDstStageMask = &waitStage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &batch.acquireCommandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &ring.uploadSemaphore,
+    };
+    res = vkQueueSubmit(ring.graphicsQueue, 1, &acquireSubmitInfo, VK_NULL_HANDLE);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to submit staging ownership acquire : " << res << std::endl;
+
+    ring.inFlight.emplace_back(std::move(batch));
+    return ring.submittedValue;
+}
+
+/**
+ * @brief flush and wait for every upload to complete
+ *
+ */
+inline void wait_idle(Ring &ring)
+{
+    flush(ring);
+    while (!ring.inFlight.empty())
+        retire_batches(ring, true);
+}
+
+inline void destroy_staging_ring(Ring &ring)
+{
+    if (ring.buffer == VK_NULL_HANDLE)
+        return;
+
+    wait_idle(ring);
+    for (Batch &batch : ring.freeBatches)
+    {
+        vkFreeCommandBuffers(ring.device, ring.transferCommandPool, 1, &batch.commandBuffer);
+        if (batch.acquireCommandBuffer != VK_NULL_HANDLE)
+            vkFreeCommandBuffers(ring.device, ring.graphicsCommandPool, 1, &batch.acquireCommandBuffer);
+    }
+    ring.freeBatches.clear();
+
+    free_memory(*ring.allocator, ring.allocation);
+    Buffer::destroy_buffer(ring.device, ring.buffer);
+    Parallel::destroy_semaphore(ring.device, ring.uploadSemaphore);
+    Command::destroy_command_pool(ring.device, ring.transferCommandPool);
+    if (has_dedicated_transfer_queue(ring))
+    {
+        Parallel::destroy_semaphore(ring.device, ring.transferSemaphore);
+        Command::destroy_command_pool(ring.device, ring.graphicsCommandPool);
+    }
+}
+
+/**
+ * @brief get the batch being recorded, beginning a new one if needed
+ *
+ */
+inline Batch &get_recording_batch(Ring &ring)
+{
+    if (ring.recording.has_value())
+        return ring.recording.value();
+
+    Batch batch;
+    if (!ring.freeBatches.empty())
+    {
+        batch = std::move(ring.freeBatches.back());
+        ring.freeBatches.pop_back();
+        vkResetCommandBuffer(batch.commandBuffer, 0);
+    }
+    else
+    {
+        batch.commandBuffer = Command::allocate_command_buffers(ring.device, ring.transferCommandPool, 1)[0];
+    }
+    Command::begin_recording_context(batch.context, batch.commandBuffer);
+
+    ring.recording = std::move(batch);
+    return ring.recording.value();
+}
+
+/**
+ * @brief find contiguous space between head and tail without waiting
+ *
  */
-inline std::pair<VkBuffer, VkDeviceMemory> create_optimal_buffer_from_data(
-    VkDevice device, VkPhysicalDevice physicalDevice, size_t size, const void *data, VkCommandPool commandPoolTransient,
-    VkQueue graphicsQueue, VkBufferUsageFlags usage = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+inline std::optional<VkDeviceSize> try_reserve(Ring &ring, VkDeviceSize size, VkDeviceSize alignment)
 {
-    // staging buffer
+    bool bEmpty = ring.inFlight.empty() && !ring.recording.has_value();
+    VkDeviceSize offset = align_up(ring.head, alignment);
+
+    if (bEmpty || ring.head > ring.tail)
+    {
+        // free space is [head, size) then [0, tail)
+        if (offset + size <= ring.size)
+            return std::optional<VkDeviceSize>(offset);
+        if (size <= ring.tail)
+            return std::optional<VkDeviceSize>(0);
+    }
+    else if (ring.head < ring.tail)
+    {
+        // wrapped, free space is [head, tail)
+        if (offset + size <= ring.tail)
+            return std::optional<VkDeviceSize>(offset);
+    }
 
-    auto stagingBuffer = create_allocated_buffer(device, physicalDevice, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    return std::optional<VkDeviceSize>();
+}
 
-    copy_data_to_memory(device, stagingBuffer.second, data, size);
+/**
+ * @brief copy data into the ring, recycling the space of completed batches and waiting for them if full
+ *
+ * @return std::pair<VkBuffer, VkDeviceSize> source buffer and offset to copy from, VK_NULL_HANDLE if the ring is empty
+ * or the dedicated staging buffer could not be created
+ */
+inline std::pair<VkBuffer, VkDeviceSize> stage_data(Ring &ring, const void *data, VkDeviceSize size,
+                                                    VkDeviceSize alignment = 16)
+{
+    if (ring.buffer == VK_NULL_HANDLE)
+    {
+        std::cerr << "Failed to stage data : the staging ring has not been created" << std::endl;
+        return {VK_NULL_HANDLE, 0};
+    }
 
-    // buffer
+    retire_batches(ring);
 
-    auto buffer = create_allocated_buffer(device, physicalDevice, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
-                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    std::optional<VkDeviceSize> offset = try_reserve(ring, size, alignment);
+    while (!offset.has_value() && size <= ring.size)
+    {
+        // submit what is pending so its space can be reclaimed, then wait for the oldest batch
+        flush(ring);
+        retire_batches(ring, true);
+        offset = try_reserve(ring, size, alignment);
+    }
+
+    if (!offset.has_value())
+    {
+        // bigger than the whole ring, fall back to a dedicated staging buffer released with the batch
+        auto stagingBuffer =
+            Buffer::create_allocated_buffer(ring.device, *ring.allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        if (stagingBuffer.first == VK_NULL_HANDLE)
+        {
+            std::cerr << "Failed to create dedicated staging buffer of " << size << " bytes" << std::endl;
+            return {VK_NULL_HANDLE, 0};
+        }
+        copy_data_to_memory(*ring.allocator, stagingBuffer.second, data, size);
+
+        Batch &batch = get_recording_batch(ring);
+        ++batch.copyCount;
+        batch.dedicatedBuffers.emplace_back(stagingBuffer);
+        return {stagingBuffer.first, 0};
+    }
+
+    Batch &batch = get_recording_batch(ring);
+    ++batch.copyCount;
+
+    memcpy(static_cast<char *>(ring.allocation.mapped) + offset.value(), data, size);
+    ring.head = offset.value() + size;
+
+    return {ring.buffer, offset.value()};
+}
+
+/**
+ * @brief record a copy of data to a buffer, usable by the graphics queue once the ring is flushed
+ *
+ * Nothing is recorded if the data could not be staged.
+ *
+ */
+inline void upload_to_buffer(Ring &ring, VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *data,
+                             VkDeviceSize size)
+{
+    auto [srcBuffer, srcOffset] = stage_data(ring, data, size);
+    if (srcBuffer == VK_NULL_HANDLE)
+        return;
+    Batch &batch = ring.recording.value();
+
+    VkBufferCopy copyRegion = {
+        .srcOffset = srcOffset,
+        .dstOffset = dstOffset,
+        .size = size,
+    };
+    Command::record_copy(batch.context, srcBuffer, dstBuffer, copyRegion);
+
+    // a single global barrier is recorded on flush with a single queue
+    if (has_dedicated_transfer_queue(ring))
+    {
+        // release, the destination access mask is ignored
+        VkBufferMemoryBarrier barrier = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = 0,
+            .srcQueueFamilyIndex = ring.transferFamilyIndex,
+            .dstQueueFamilyIndex = ring.graphicsFamilyIndex,
+            .buffer = dstBuffer,
+            .offset = dstOffset,
+            .size = size,
+        };
+        Command::record_post_copy_barrier(batch.context, barrier, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+        // acquire, the source access mask is ignored
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        batch.acquireBufferBarriers.emplace_back(barrier);
+    }
+}
+
+/**
+ * @brief record a copy of data to the whole image, left in shader read only layout once the ring is flushed
+ *
+ * Nothing is recorded if the data could not be staged.
+ *
+ */
+inline void upload_to_image(Ring &ring, VkImage dstImage, uint32_t width, uint32_t height, const void *data,
+                            VkDeviceSize size, VkImageAspectFlags aspectFlag = VK_IMAGE_ASPECT_COLOR_BIT)
+{
+    auto [srcBuffer, srcOffset] = stage_data(ring, data, size);
+    if (srcBuffer == VK_NULL_HANDLE)
+        return;
+    Batch &batch = ring.recording.value();
+
+    VkImageSubresourceRange subresourceRange = {
+        .aspectMask = aspectFlag,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = 1,
+    };
+    // the previous content is discarded, no ownership transfer is needed before the copy
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = dstImage,
+        .subresourceRange = subresourceRange,
+    };
+    Command::record_pre_copy_barrier(batch.context, barrier, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkBufferImageCopy region = {
+        .bufferOffset = srcOffset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            {
+                .aspectMask = aspectFlag,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {width, height, 1},
+    };
+    Command::record_copy(batch.context, srcBuffer, dstImage, region);
+
+    // the layout transition is part of the ownership transfer if any
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    if (!has_dedicated_transfer_queue(ring))
+    {
+        Command::record_post_copy_barrier(batch.context, barrier, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        return;
+    }
+
+    // release, the destination access mask is ignored
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = ring.transferFamilyIndex;
+    barrier.dstQueueFamilyIndex = ring.graphicsFamilyIndex;
+    Command::record_post_copy_barrier(batch.context, barrier, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    // acquire, the source access mask is ignored
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    batch.acquireImageBarriers.emplace_back(barrier);
+}
+} // namespace Staging
 
-    transfer_buffer(device, stagingBuffer.first, buffer.first, size, commandPoolTransient, graphicsQueue);
+namespace Buffer
+{
+/**
+ * @brief Create a optimal buffer from data object by using the staging ring
+ *
+ * The copy is only recorded, it is submitted on the next flush of the ring.
+ *
+ * @param device
+ * @param allocator
+ * @param stagingRing
+ * @param size
+ * @param data
+ * @param usage
+ * @return std::pair<VkBuffer, Allocation>
+ */
+inline std::pair<VkBuffer, Allocation> create_optimal_buffer_from_data(VkDevice device, Allocator &allocator,
+                                                                       Staging::Ring &stagingRing, size_t size,
+                                                                       const void *data,
+                                                                       VkBufferUsageFlags usage = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+{
+    auto buffer = create_allocated_buffer(device, allocator, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (buffer.first == VK_NULL_HANDLE)
+        return buffer;
 
-    free_memory(device, stagingBuffer.second);
-    destroy_buffer(device, stagingBuffer.first);
+    Staging::upload_to_buffer(stagingRing, buffer.first, 0, data, size);
 
     return buffer;
 }
@@ -1268,13 +3194,13 @@ inline void destroy_image(VkDevice device, VkImage image)
     vkDestroyImage(device, image, nullptr);
 }
 
-inline void bind_memory_to_image(VkDevice device, VkImage image, VkDeviceMemory memory)
+inline void bind_memory_to_image(VkDevice device, VkImage image, VkDeviceMemory memory, VkDeviceSize offset = 0)
 {
-    vkBindImageMemory(device, image, memory, 0);
+    vkBindImageMemory(device, image, memory, offset);
 }
 
-inline std::pair<VkImage, VkDeviceMemory> create_allocated_image(
-    VkDevice device, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height,
+inline std::pair<VkImage, Allocation> create_allocated_image(
+    VkDevice device, Allocator &allocator, uint32_t width, uint32_t height,
     VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
     VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL,
     VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
@@ -1282,13 +3208,17 @@ inline std::pair<VkImage, VkDeviceMemory> create_allocated_image(
     VkImage image = create_image(device, width, height, usage, format, tiling);
     VkMemoryRequirements memReq;
     vkGetImageMemoryRequirements(device, image, &memReq);
-    std::optional<uint32_t> memoryTypeIndex =
-        Device::Memory::find_memory_type_index(physicalDevice, memReq, properties);
 
-    VkDeviceMemory memory = allocate_memory(device, memReq.size, memoryTypeIndex.value());
-    bind_memory_to_image(device, image, memory);
+    Allocation allocation = allocate(allocator, memReq, properties, tiling == VK_IMAGE_TILING_LINEAR);
+    if (allocation.memory == VK_NULL_HANDLE)
+    {
+        std::cerr << "Failed to allocate image memory : " << memReq.size << " bytes" << std::endl;
+        destroy_image(device, image);
+        return {VK_NULL_HANDLE, Allocation{}};
+    }
+    bind_memory_to_image(device, image, allocation.memory, allocation.offset);
 
-    return {image, memory};
+    return {image, allocation};
 }
 
 inline void transition_image_layout(VkDevice device, VkCommandPool commandPoolTransient, VkQueue queue,
@@ -1356,35 +3286,67 @@ inline void copy_buffer_to_image(VkDevice device, VkCommandPool commandPoolTrans
 
     Command::command_buffer_end_one_time_submit(commandBuffer, device, queue, commandPoolTransient);
 }
-
-inline std::pair<VkImage, VkDeviceMemory> create_image_texture_from_data(
-    VkDevice device, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, const void *data,
-    VkCommandPool commandPoolTransient, VkQueue graphicsQueue, VkFormat imageFormat = VK_FORMAT_R8G8B8A8_SRGB)
+/**
+ * @brief record the copy of the color of an image to a tightly packed buffer
+ *
+ * @param commandBuffer
+ * @param image in TRANSFER_SRC_OPTIMAL layout
+ * @param width
+ * @param height
+ * @param buffer
+ * @param bufferOffset
+ */
+inline void record_copy_image_to_buffer(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height,
+                                        VkBuffer buffer, VkDeviceSize bufferOffset = 0)
 {
-    size_t imageSize = width * height * 4;
+    VkBufferImageCopy region = {
+        .bufferOffset = bufferOffset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        .imageOffset =
+            {
+                .x = 0,
+                .y = 0,
+                .z = 0,
+            },
+        .imageExtent =
+            {
+                .width = width,
+                .height = height,
+                .depth = 1,
+            },
+    };
 
-    auto stagingBuffer =
-        Buffer::create_allocated_buffer(device, physicalDevice, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+}
 
-    copy_data_to_memory(device, stagingBuffer.second, data, imageSize);
+/**
+ * @brief Create a sampled image from data by using the staging ring
+ *
+ * The copy and the layout transitions are only recorded, they are submitted on the next flush of the ring.
+ *
+ */
+inline std::pair<VkImage, Allocation> create_image_texture_from_data(VkDevice device, Allocator &allocator,
+                                                                     Staging::Ring &stagingRing, uint32_t width,
+                                                                     uint32_t height, const void *data,
+                                                                     VkFormat imageFormat = VK_FORMAT_R8G8B8A8_SRGB)
+{
+    size_t imageSize = width * height * 4;
 
-    auto image = create_allocated_image(device, physicalDevice, width, height,
+    auto image = create_allocated_image(device, allocator, width, height,
                                         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, imageFormat,
                                         VK_IMAGE_TILING_OPTIMAL, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (image.first == VK_NULL_HANDLE)
+        return image;
 
-    transition_image_layout(device, commandPoolTransient, graphicsQueue, VK_IMAGE_LAYOUT_UNDEFINED,
-                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image.first, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
-                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                            VK_IMAGE_ASPECT_COLOR_BIT);
-    copy_buffer_to_image(device, commandPoolTransient, width, height, stagingBuffer.first, image.first, graphicsQueue);
-    transition_image_layout(device, commandPoolTransient, graphicsQueue, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, image.first, VK_ACCESS_TRANSFER_WRITE_BIT,
-                            VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-
-    free_memory(device, stagingBuffer.second);
-    Buffer::destroy_buffer(device, stagingBuffer.first);
+    Staging::upload_to_image(stagingRing, image.first, width, height, data, imageSize);
 
     return image;
 }
@@ -1421,45 +3383,381 @@ inline VkImageView create_image_view(VkDevice device, VkImage image, VkFormat im
 
     return imageView;
 }
-inline void destroy_image_view(VkDevice device, VkImageView imageView)
+inline void destroy_image_view(VkDevice device, VkImageView imageView)
+{
+    vkDestroyImageView(device, imageView, nullptr);
+}
+
+inline VkSampler create_image_sampler(VkDevice device, VkFilter filter, bool bEnableAnisotropy = false,
+                                      float maxAnisotropy = 1.f)
+{
+    VkSamplerCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = filter,
+        .minFilter = filter,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .mipLodBias = 0.f,
+        .anisotropyEnable = bEnableAnisotropy,
+        .maxAnisotropy = maxAnisotropy,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_ALWAYS,
+        .minLod = 0.f,
+        .maxLod = 0.f,
+        .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+        .unnormalizedCoordinates = VK_FALSE,
+    };
+
+    VkSampler sampler;
+    VkResult res = vkCreateSampler(device, &createInfo, nullptr, &sampler);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to create image sampler : " << res << std::endl;
+
+    return sampler;
+}
+inline void destroy_image_sampler(VkDevice device, VkSampler sampler)
+{
+    vkDestroySampler(device, sampler, nullptr);
+}
+} // namespace Image
+
+// Asynchronous copies of rendered images to the host
+namespace Readback
+{
+/**
+ * @brief called on the thread polling the ring, data is only valid during the call
+ *
+ */
+using Consumer = std::function<void(uint64_t frameNumber, const void *data, VkDeviceSize size, uint32_t width,
+                                    uint32_t height)>;
+
+struct Slot
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    Allocation allocation;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    // signaled once the copy is complete, the slot is free again after the consumer has been called
+    VkFence fence = VK_NULL_HANDLE;
+    uint64_t frameNumber = 0;
+    bool bPending = false;
+};
+
+/**
+ * @brief the frames are handed to the consumer in submission order, slotCount frames at most after their submission
+ *
+ */
+struct Ring
+{
+    VkDevice device;
+    Allocator *allocator;
+    VkCommandPool commandPool;
+
+    uint32_t width;
+    uint32_t height;
+    VkDeviceSize frameSize;
+
+    std::vector<Slot> slots;
+    // oldest pending slot, then the next slot to fill
+    uint32_t nextSlot = 0;
+    uint32_t pendingCount = 0;
+
+    Consumer consumer;
+    // frames skipped because every slot was still pending
+    uint64_t droppedCount = 0;
+};
+
+/**
+ * @brief Create a readback ring object
+ *
+ * @param device
+ * @param allocator
+ * @param queueFamilyIndex family of the queue rendering the frames
+ * @param width
+ * @param height
+ * @param bytesPerPixel of the format of the images read back
+ * @param slotCount frames in flight between the copy and the consumer
+ * @param consumer
+ * @return Ring
+ */
+inline Ring create_readback_ring(VkDevice device, Allocator &allocator, uint32_t queueFamilyIndex, uint32_t width,
+                                 uint32_t height, uint32_t bytesPerPixel, uint32_t slotCount, Consumer consumer)
+{
+    Ring ring;
+    ring.device = device;
+    ring.allocator = &allocator;
+    ring.commandPool = Command::create_command_pool(device, queueFamilyIndex);
+    ring.width = width;
+    ring.height = height;
+    ring.frameSize = static_cast<VkDeviceSize>(width) * height * bytesPerPixel;
+    ring.consumer = std::move(consumer);
+
+    // cached memory for fast host reads, coherent memory is uncached on most devices
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    bool bHasCachedMemory = false;
+    for (uint32_t i = 0; i < allocator.memoryProperties.memoryTypeCount; ++i)
+        bHasCachedMemory |= (allocator.memoryProperties.memoryTypes[i].propertyFlags & properties) == properties;
+    if (!bHasCachedMemory)
+        properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+    std::vector<VkCommandBuffer> commandBuffers =
+        Command::allocate_command_buffers(device, ring.commandPool, slotCount);
+    ring.slots.resize(slotCount);
+    for (uint32_t i = 0; i < slotCount; ++i)
+    {
+        Slot &slot = ring.slots[i];
+        auto buffer = Buffer::create_allocated_buffer(device, allocator, ring.frameSize,
+                                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT, properties);
+        slot.buffer = buffer.first;
+        slot.allocation = buffer.second;
+        slot.commandBuffer = commandBuffers[i];
+        slot.fence = Parallel::create_fence(device);
+    }
+
+    return ring;
+}
+
+/**
+ * @brief hand the completed copies to the consumer, oldest first
+ *
+ * @param ring
+ * @param bWait wait for every pending copy instead of stopping at the first incomplete one
+ * @return uint32_t number of frames consumed
+ */
+inline uint32_t poll_readbacks(Ring &ring, bool bWait = false)
+{
+    uint32_t consumedCount = 0;
+    while (ring.pendingCount > 0)
+    {
+        uint32_t slotCount = static_cast<uint32_t>(ring.slots.size());
+        Slot &slot = ring.slots[(ring.nextSlot + slotCount - ring.pendingCount) % slotCount];
+        if (bWait)
+            vkWaitForFences(ring.device, 1, &slot.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        else if (vkGetFenceStatus(ring.device, slot.fence) != VK_SUCCESS)
+            break;
+
+        invalidate_allocation(*ring.allocator, slot.allocation, 0, ring.frameSize);
+        if (ring.consumer)
+            ring.consumer(slot.frameNumber, slot.allocation.mapped, ring.frameSize, ring.width, ring.height);
+
+        slot.bPending = false;
+        --ring.pendingCount;
+        ++consumedCount;
+    }
+    return consumedCount;
+}
+
+/**
+ * @brief submit the copy of a rendered image, never blocks
+ *
+ * Submit after the frame on the same queue, the submission order makes the copy wait for the rendering. The frame is
+ * dropped if every slot is still pending.
+ *
+ * @param ring
+ * @param queue
+ * @param image color image of the ring's size, in TRANSFER_SRC_OPTIMAL layout at the end of the frame
+ * @param frameNumber given back to the consumer
+ * @return bool false if the frame was dropped
+ */
+inline bool read_back_image(Ring &ring, VkQueue queue, VkImage image, uint64_t frameNumber)
+{
+    poll_readbacks(ring);
+    if (ring.pendingCount == ring.slots.size())
+    {
+        ++ring.droppedCount;
+        return false;
+    }
+
+    Slot &slot = ring.slots[ring.nextSlot];
+    vkResetFences(ring.device, 1, &slot.fence);
+    vkResetCommandBuffer(slot.commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    VkResult res = vkBeginCommandBuffer(slot.commandBuffer, &beginInfo);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to begin readback command buffer : " << res << std::endl;
+
+    Image::record_copy_image_to_buffer(slot.commandBuffer, image, ring.width, ring.height, slot.buffer);
+
+    // the fence does not make the transfer writes available to the host
+    VkBufferMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = slot.buffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+    vkCmdPipelineBarrier(slot.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0,
+                         nullptr, 1, &barrier, 0, nullptr);
+
+    res = vkEndCommandBuffer(slot.commandBuffer);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to end readback command buffer : " << res << std::endl;
+
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &slot.commandBuffer,
+    };
+    res = vkQueueSubmit(queue, 1, &submitInfo, slot.fence);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to submit readback : " << res << std::endl;
+
+    slot.frameNumber = frameNumber;
+    slot.bPending = true;
+    ring.nextSlot = (ring.nextSlot + 1) % static_cast<uint32_t>(ring.slots.size());
+    ++ring.pendingCount;
+    return true;
+}
+
+/**
+ * @brief hand the pending frames to the consumer and destroy the ring
+ *
+ */
+inline void destroy_readback_ring(Ring &ring)
+{
+    poll_readbacks(ring, true);
+    for (Slot &slot : ring.slots)
+    {
+        Parallel::destroy_fence(ring.device, slot.fence);
+        free_memory(*ring.allocator, slot.allocation);
+        Buffer::destroy_buffer(ring.device, slot.buffer);
+    }
+    ring.slots.clear();
+    Command::destroy_command_pool(ring.device, ring.commandPool);
+}
+} // namespace Readback
+
+// Per frame uniforms, bound once as dynamic uniform buffers and selected with their dynamic offsets
+namespace Uniform
+{
+/**
+ * @brief persistently mapped buffer split in a region per frame in flight, each region is a linear allocator reset
+ * at the beginning of its frame
+ *
+ * The allocations are not synchronized, they are made by the thread recording the frame.
+ *
+ */
+struct Arena
+{
+    VkDevice device = VK_NULL_HANDLE;
+    Allocator *allocator = nullptr;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    Allocation allocation;
+    // minUniformBufferOffsetAlignment
+    VkDeviceSize alignment = 0;
+    VkDeviceSize frameSize = 0;
+    uint32_t frameInFlightCount = 0;
+
+    // region of the current frame and next write offset in it
+    VkDeviceSize frameBegin = 0;
+    VkDeviceSize head = 0;
+    // bytes allocated by the most demanding frame
+    VkDeviceSize peakSize = 0;
+};
+
+/**
+ * @brief Create a uniform arena object
+ *
+ * @param device
+ * @param allocator
+ * @param physicalDevice
+ * @param frameInFlightCount
+ * @param frameSize bytes available to each frame, rounded up to the offset alignment
+ * @return Arena
+ */
+inline Arena create_uniform_arena(VkDevice device, Allocator &allocator, VkPhysicalDevice physicalDevice,
+                                  uint32_t frameInFlightCount, VkDeviceSize frameSize = 4ull * 1024ull * 1024ull)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    Arena arena;
+    arena.device = device;
+    arena.allocator = &allocator;
+    arena.alignment = properties.limits.minUniformBufferOffsetAlignment;
+    arena.frameSize = align_up(frameSize, arena.alignment);
+    arena.frameInFlightCount = frameInFlightCount;
+
+    auto buffer = Buffer::create_allocated_buffer(device, allocator, arena.frameSize * frameInFlightCount,
+                                                  VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    arena.buffer = buffer.first;
+    arena.allocation = buffer.second;
+
+    return arena;
+}
+inline void destroy_uniform_arena(Arena &arena)
+{
+    free_memory(*arena.allocator, arena.allocation);
+    Buffer::destroy_buffer(arena.device, arena.buffer);
+    arena.buffer = VK_NULL_HANDLE;
+}
+
+/**
+ * @brief release every allocation of the frame, its fence must have been waited on
+ *
+ */
+inline void begin_frame(Arena &arena, uint32_t frameInFlightIndex)
 {
-    vkDestroyImageView(device, imageView, nullptr);
+    arena.frameBegin = arena.frameSize * frameInFlightIndex;
+    arena.head = arena.frameBegin;
 }
 
-inline VkSampler create_image_sampler(VkDevice device, VkFilter filter, bool bEnableAnisotropy = false,
-                                      float maxAnisotropy = 1.f)
+/**
+ * @brief reserve size bytes in the region of the current frame
+ *
+ * @return std::optional<uint32_t> dynamic offset of the allocation, empty if the region is full
+ */
+inline std::optional<uint32_t> allocate(Arena &arena, VkDeviceSize size)
 {
-    VkSamplerCreateInfo createInfo = {
-        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-        .magFilter = filter,
-        .minFilter = filter,
-        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
-        .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-        .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-        .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-        .mipLodBias = 0.f,
-        .anisotropyEnable = bEnableAnisotropy,
-        .maxAnisotropy = maxAnisotropy,
-        .compareEnable = VK_FALSE,
-        .compareOp = VK_COMPARE_OP_ALWAYS,
-        .minLod = 0.f,
-        .maxLod = 0.f,
-        .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
-        .unnormalizedCoordinates = VK_FALSE,
-    };
+    VkDeviceSize offset = arena.head;
+    if (offset + size > arena.frameBegin + arena.frameSize)
+    {
+        std::cerr << "Failed to allocate uniform : arena frame of " << arena.frameSize << " bytes full" << std::endl;
+        return std::optional<uint32_t>();
+    }
 
-    VkSampler sampler;
-    VkResult res = vkCreateSampler(device, &createInfo, nullptr, &sampler);
-    if (res != VK_SUCCESS)
-        std::cerr << "Failed to create image sampler : " << res << std::endl;
+    arena.head = align_up(offset + size, arena.alignment);
+    arena.peakSize = (std::max)(arena.peakSize, arena.head - arena.frameBegin);
+    return std::optional<uint32_t>(static_cast<uint32_t>(offset));
+}
 
-    return sampler;
+/**
+ * @brief copy the uniforms of one object in the current frame
+ *
+ * @return std::optional<uint32_t> dynamic offset to bind the descriptor set with
+ */
+template <typename T> inline std::optional<uint32_t> push(Arena &arena, const T &uniforms)
+{
+    std::optional<uint32_t> offset = allocate(arena, sizeof(T));
+    if (offset.has_value())
+        memcpy(static_cast<char *>(arena.allocation.mapped) + offset.value(), &uniforms, sizeof(T));
+    return offset;
 }
-inline void destroy_image_sampler(VkDevice device, VkSampler sampler)
+
+/**
+ * @brief range seen by a dynamic uniform buffer descriptor, the dynamic offset selects the object
+ *
+ */
+inline VkDescriptorBufferInfo get_descriptor_buffer_info(const Arena &arena, VkDeviceSize range)
 {
-    vkDestroySampler(device, sampler, nullptr);
+    return VkDescriptorBufferInfo{
+        .buffer = arena.buffer,
+        .offset = 0,
+        .range = range,
+    };
 }
-} // namespace Image
+} // namespace Uniform
 } // namespace Memory
 
 namespace Render
@@ -1481,8 +3779,11 @@ inline uint32_t acquire_back_buffer(VkDevice device, VkSwapchainKHR swapchain, V
     return imageIndex;
 }
 
-inline void record_back_buffer_begin_render_pass(VkCommandBuffer commandBuffer, VkRenderPass renderPass,
-                                                 VkFramebuffer framebuffer, VkExtent2D extent, VkPipeline pipeline)
+/**
+ * @brief reset and begin the primary command buffer of the frame
+ *
+ */
+inline bool record_back_buffer_begin(VkCommandBuffer commandBuffer)
 {
     vkResetCommandBuffer(commandBuffer, 0);
 
@@ -1492,9 +3793,18 @@ inline void record_back_buffer_begin_render_pass(VkCommandBuffer commandBuffer,
     if (res != VK_SUCCESS)
     {
         std::cerr << "Failed to begin recording command buffer : " << res << std::endl;
-        return;
+        return false;
     }
-
+    return true;
+}
+/**
+ * @brief begin the render pass in a command buffer already begun, to record commands outside of the render pass
+ *
+ */
+inline void record_begin_render_pass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer,
+                                     VkExtent2D extent, VkPipeline pipeline,
+                                     VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE)
+{
     VkClearValue clearColor = {
         .color = {0.2f, 0.2f, 0.2f, 1.f},
     };
@@ -1510,7 +3820,68 @@ inline void record_back_buffer_begin_render_pass(VkCommandBuffer commandBuffer,
         .clearValueCount = static_cast<uint32_t>(clearValues.size()),
         .pClearValues = clearValues.data(),
     };
-    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, contents);
+    if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+        return;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+    VkViewport viewport = {
+        .x = 0.f,
+        .y = 0.f,
+        .width = static_cast<float>(extent.width),
+        .height = static_cast<float>(extent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    VkRect2D scissor = {
+        .offset = {0, 0},
+        .extent = extent,
+    };
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+/**
+ * @brief begin the command buffer and the render pass
+ *
+ * With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, the pipeline and dynamic states are left to the secondary
+ * command buffers executed with record_back_buffer_execute_commands.
+ *
+ */
+inline void record_back_buffer_begin_render_pass(VkCommandBuffer commandBuffer, VkRenderPass renderPass,
+                                                 VkFramebuffer framebuffer, VkExtent2D extent, VkPipeline pipeline,
+                                                 VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE)
+{
+    if (record_back_buffer_begin(commandBuffer))
+        record_begin_render_pass(commandBuffer, renderPass, framebuffer, extent, pipeline, contents);
+}
+/**
+ * @brief begin a secondary command buffer continuing the render pass of the primary command buffer
+ *
+ * The pipeline and the dynamic states are not inherited from the primary command buffer and are set again.
+ *
+ */
+inline void record_secondary_begin_render_pass(VkCommandBuffer commandBuffer, VkRenderPass renderPass,
+                                               uint32_t subpass, VkFramebuffer framebuffer, VkExtent2D extent,
+                                               VkPipeline pipeline)
+{
+    VkCommandBufferInheritanceInfo inheritanceInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .renderPass = renderPass,
+        .subpass = subpass,
+        .framebuffer = framebuffer,
+    };
+    VkCommandBufferBeginInfo commandBufferBeginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritanceInfo,
+    };
+    VkResult res = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+    if (res != VK_SUCCESS)
+    {
+        std::cerr << "Failed to begin recording secondary command buffer : " << res << std::endl;
+        return;
+    }
 
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
@@ -1529,11 +3900,45 @@ inline void record_back_buffer_begin_render_pass(VkCommandBuffer commandBuffer,
     };
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
+inline void record_secondary_end(VkCommandBuffer commandBuffer)
+{
+    VkResult res = vkEndCommandBuffer(commandBuffer);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to record secondary command buffer : " << res << std::endl;
+}
+/**
+ * @brief execute every secondary command buffer of the frame at once
+ *
+ */
+inline void record_back_buffer_execute_commands(VkCommandBuffer commandBuffer,
+                                                const std::vector<VkCommandBuffer> &secondaryCommandBuffers)
+{
+    if (secondaryCommandBuffers.empty())
+        return;
+    vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()),
+                         secondaryCommandBuffers.data());
+}
+
+/**
+ * @brief bind the set 0, with an offset per dynamic descriptor of the set in binding order
+ *
+ */
 inline void record_back_buffer_descriptor_sets_commands(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
-                                                        VkDescriptorSet descriptorSet)
+                                                        VkDescriptorSet descriptorSet,
+                                                        std::initializer_list<uint32_t> dynamicOffsets = {})
+{
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet,
+                            static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.begin());
+}
+/**
+ * @brief update the push constants of the following draws, the range must be declared in the pipeline layout
+ *
+ */
+template <typename T>
+inline void record_push_constants(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+                                  VkShaderStageFlags stageFlags, const T &constants, uint32_t offset = 0)
 {
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0,
-                            nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, stageFlags, offset, sizeof(T), &constants);
 }
 inline void record_back_buffer_draw_object_commands(VkCommandBuffer commandBuffer, VkBuffer vertexBuffer,
                                                     uint32_t vertexCount)
@@ -1552,24 +3957,107 @@ inline void record_back_buffer_draw_indexed_object_commands(VkCommandBuffer comm
     vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
     vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
 }
-inline void record_back_buffer_end_render_pass(VkCommandBuffer commandBuffer)
+/**
+ * @brief push the per draw data (model matrix, material ID...) before drawing, so that any number of objects is drawn
+ * without descriptor set nor buffer write per object
+ *
+ * @tparam T push constant block of the shaders, declared in the pipeline layout for stageFlags
+ */
+template <typename T>
+inline void record_back_buffer_draw_indexed_object_commands(VkCommandBuffer commandBuffer,
+                                                            VkPipelineLayout pipelineLayout,
+                                                            VkShaderStageFlags stageFlags, const T &constants,
+                                                            VkBuffer vertexBuffer, VkBuffer indexBuffer,
+                                                            uint32_t indexCount)
+{
+    record_push_constants(commandBuffer, pipelineLayout, stageFlags, constants);
+    record_back_buffer_draw_indexed_object_commands(commandBuffer, vertexBuffer, indexBuffer, indexCount);
+}
+/**
+ * @brief draw every instance of a mesh at once, the instance buffer is bound to the binding 1
+ *
+ */
+inline void record_back_buffer_draw_indexed_instanced_commands(VkCommandBuffer commandBuffer, VkBuffer vertexBuffer,
+                                                               VkBuffer instanceBuffer, VkBuffer indexBuffer,
+                                                               uint32_t indexCount, uint32_t instanceCount,
+                                                               uint32_t firstInstance = 0)
+{
+    VkBuffer vbos[] = {vertexBuffer, instanceBuffer};
+    VkDeviceSize offsets[] = {0, 0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, vbos, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+    vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
+}
+/**
+ * @brief draw the indexed draw commands written by the device, as many as the count buffer holds
+ *
+ * @param commandBuffer
+ * @param vertexBuffer shared by every draw
+ * @param indexBuffer shared by every draw
+ * @param drawBuffer tightly packed VkDrawIndexedIndirectCommand
+ * @param countBuffer uint32_t draw count
+ * @param maxDrawCount capacity of the draw buffer
+ */
+inline void record_back_buffer_draw_indexed_indirect_count_commands(VkCommandBuffer commandBuffer,
+                                                                    VkBuffer vertexBuffer, VkBuffer indexBuffer,
+                                                                    VkBuffer drawBuffer, VkBuffer countBuffer,
+                                                                    uint32_t maxDrawCount)
+{
+    VkBuffer vbos[] = {vertexBuffer};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vbos, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+    vkCmdDrawIndexedIndirectCount(commandBuffer, drawBuffer, 0, countBuffer, 0, maxDrawCount,
+                                  sizeof(VkDrawIndexedIndirectCommand));
+}
+inline void record_end_render_pass(VkCommandBuffer commandBuffer)
 {
     vkCmdEndRenderPass(commandBuffer);
-
+}
+inline void record_back_buffer_end(VkCommandBuffer commandBuffer)
+{
     VkResult res = vkEndCommandBuffer(commandBuffer);
     if (res != VK_SUCCESS)
         std::cerr << "Failed to record command buffer : " << res << std::endl;
 }
+inline void record_back_buffer_end_render_pass(VkCommandBuffer commandBuffer)
+{
+    record_end_render_pass(commandBuffer);
+    record_back_buffer_end(commandBuffer);
+}
 
+/**
+ * @brief submit the frame, waiting for the acquired image and optionally for compute work submitted with
+ * Compute::submit_compute
+ *
+ * @param graphicsQueue
+ * @param commandBuffer
+ * @param acquireSemaphore
+ * @param renderSemaphore
+ * @param inFlightFence
+ * @param computeSemaphore timeline semaphore signaled by the compute work, VK_NULL_HANDLE to not wait
+ * @param computeWaitValue
+ * @param computeWaitStage first stage reading the results, the previous stages overlap the compute work
+ */
 inline void submit_back_buffer(VkQueue graphicsQueue, VkCommandBuffer commandBuffer, VkSemaphore &acquireSemaphore,
-                               VkSemaphore &renderSemaphore, VkFence &inFlightFence)
+                               VkSemaphore &renderSemaphore, VkFence &inFlightFence,
+                               VkSemaphore computeSemaphore = VK_NULL_HANDLE, uint64_t computeWaitValue = 0,
+                               VkPipelineStageFlags computeWaitStage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT)
 {
-    VkSemaphore waitSemaphores[] = {acquireSemaphore};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    VkSemaphore waitSemaphores[] = {acquireSemaphore, computeSemaphore};
+    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, computeWaitStage};
+    // the value of the binary semaphore is ignored
+    uint64_t waitValues[] = {0, computeWaitValue};
     VkSemaphore signalSemaphores[] = {renderSemaphore};
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .waitSemaphoreValueCount = 2,
+        .pWaitSemaphoreValues = waitValues,
+    };
     VkSubmitInfo submitInfo = {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .waitSemaphoreCount = 1,
+        .pNext = computeSemaphore != VK_NULL_HANDLE ? &timelineInfo : nullptr,
+        .waitSemaphoreCount = computeSemaphore != VK_NULL_HANDLE ? 2u : 1u,
         .pWaitSemaphores = waitSemaphores,
         .pWaitDstStageMask = waitStages,
         .commandBufferCount = 1,
@@ -1583,6 +4071,35 @@ inline void submit_back_buffer(VkQueue graphicsQueue, VkCommandBuffer commandBuf
         std::cerr << "Failed to submit draw command buffer : " << res << std::endl;
 }
 
+/**
+ * @brief headless counterpart of acquire_back_buffer, the offscreen back buffers are rendered in turn
+ *
+ */
+inline uint32_t acquire_offscreen_back_buffer(VkDevice device, uint32_t frameIndex, uint32_t backBufferCount,
+                                              VkFence &backBufferFence)
+{
+    vkWaitForFences(device, 1, &backBufferFence, VK_TRUE, UINT64_MAX);
+    vkResetFences(device, 1, &backBufferFence);
+
+    return frameIndex % backBufferCount;
+}
+/**
+ * @brief headless counterpart of submit_back_buffer, nothing is acquired nor presented so there is no semaphore
+ *
+ */
+inline void submit_offscreen_back_buffer(VkQueue graphicsQueue, VkCommandBuffer commandBuffer, VkFence &inFlightFence)
+{
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+    };
+
+    VkResult res = vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to submit draw command buffer : " << res << std::endl;
+}
+
 inline void present_back_buffer(VkQueue presentQueue, VkSwapchainKHR swapchain, uint32_t imageIndex,
                                 VkSemaphore &renderSemaphore)
 {
@@ -1603,4 +4120,200 @@ inline void present_back_buffer(VkQueue presentQueue, VkSwapchainKHR swapchain,
         std::cerr << "Failed to present : " << res << std::endl;
 }
 } // namespace Render
+
+namespace Compute
+{
+inline uint32_t get_group_count(uint32_t invocationCount, uint32_t groupSize)
+{
+    return (invocationCount + groupSize - 1) / groupSize;
+}
+
+inline void record_bind_compute_pipeline(VkCommandBuffer commandBuffer, VkPipeline pipeline,
+                                         VkPipelineLayout pipelineLayout,
+                                         const std::vector<VkDescriptorSet> &descriptorSets, uint32_t firstSet = 0)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    if (descriptorSets.empty())
+        return;
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, firstSet,
+                            static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+}
+inline void record_dispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY = 1,
+                            uint32_t groupCountZ = 1)
+{
+    if (groupCountX == 0 || groupCountY == 0 || groupCountZ == 0)
+        return;
+    vkCmdDispatch(commandBuffer, groupCountX, groupCountY, groupCountZ);
+}
+/**
+ * @brief the group counts are read from a VkDispatchIndirectCommand, e.g. written by a previous dispatch
+ *
+ */
+inline void record_dispatch_indirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset = 0)
+{
+    vkCmdDispatchIndirect(commandBuffer, buffer, offset);
+}
+
+/**
+ * @brief make the writes of the previous dispatches visible to the following commands of the same queue
+ *
+ * A global barrier only waits for the compute stage, the graphics work recorded before keeps running.
+ *
+ * @param commandBuffer
+ * @param dstStage e.g. VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT or VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+ * @param dstAccess e.g. VK_ACCESS_INDIRECT_COMMAND_READ_BIT or VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT
+ */
+inline void record_compute_write_barrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStage,
+                                         VkAccessFlags dstAccess)
+{
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = dstAccess,
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage, 0, 1, &barrier, 0, nullptr, 0,
+                         nullptr);
+}
+/**
+ * @brief let the following dispatches overwrite what the previous commands of the same queue accessed
+ *
+ */
+inline void record_compute_overwrite_barrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage,
+                                             VkAccessFlags srcAccess)
+{
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                         nullptr);
+}
+
+inline bool is_async_compute(uint32_t graphicsFamilyIndex, uint32_t computeFamilyIndex)
+{
+    return graphicsFamilyIndex != computeFamilyIndex;
+}
+/**
+ * @brief ownership transfer of an exclusive buffer between the compute and graphics families
+ *
+ * The same barrier is recorded as a release on the source queue and as an acquire on the destination queue, the
+ * destination access is ignored by the release and the source access by the acquire.
+ *
+ */
+inline VkBufferMemoryBarrier get_ownership_transfer_barrier(VkBuffer buffer, uint32_t srcFamilyIndex,
+                                                            uint32_t dstFamilyIndex, VkAccessFlags srcAccess,
+                                                            VkAccessFlags dstAccess)
+{
+    return VkBufferMemoryBarrier{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = dstAccess,
+        .srcQueueFamilyIndex = srcFamilyIndex,
+        .dstQueueFamilyIndex = dstFamilyIndex,
+        .buffer = buffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+}
+inline void record_release_barriers(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage,
+                                    const std::vector<VkBufferMemoryBarrier> &barriers)
+{
+    vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                         static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+}
+inline void record_acquire_barriers(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStage,
+                                    const std::vector<VkBufferMemoryBarrier> &barriers)
+{
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr,
+                         static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+}
+
+/**
+ * @brief submit compute work signaling a timeline value, the graphics submission waiting for it only stalls its
+ * stages consuming the results
+ *
+ * @param computeQueue
+ * @param commandBuffer
+ * @param timelineSemaphore
+ * @param signalValue
+ * @param waitValue value of timelineSemaphore to wait for before the dispatches, 0 to not wait
+ * @param fence
+ * @param inputSemaphore another timeline semaphore to wait for before the dispatches, e.g. the upload semaphore of
+ * the staging ring writing their inputs, VK_NULL_HANDLE to not wait
+ * @param inputWaitValue
+ */
+inline void submit_compute(VkQueue computeQueue, VkCommandBuffer commandBuffer, VkSemaphore timelineSemaphore,
+                           uint64_t signalValue, uint64_t waitValue = 0, VkFence fence = VK_NULL_HANDLE,
+                           VkSemaphore inputSemaphore = VK_NULL_HANDLE, uint64_t inputWaitValue = 0)
+{
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    if (waitValue > 0)
+    {
+        waitSemaphores.emplace_back(timelineSemaphore);
+        waitValues.emplace_back(waitValue);
+    }
+    if (inputSemaphore != VK_NULL_HANDLE)
+    {
+        waitSemaphores.emplace_back(inputSemaphore);
+        waitValues.emplace_back(inputWaitValue);
+    }
+    std::vector<VkPipelineStageFlags> waitStages(waitSemaphores.size(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size()),
+        .pWaitSemaphoreValues = waitValues.data(),
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &signalValue,
+    };
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timelineInfo,
+        .waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size()),
+        .pWaitSemaphores = waitSemaphores.data(),
+        .pWaitDstStageMask = waitStages.data(),
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &timelineSemaphore,
+    };
+
+    VkResult res = vkQueueSubmit(computeQueue, 1, &submitInfo, fence);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to submit compute command buffer : " << res << std::endl;
+}
+/**
+ * @brief submit graphics work consuming the results of submit_compute
+ *
+ * @param graphicsQueue
+ * @param commandBuffer
+ * @param timelineSemaphore
+ * @param waitValue
+ * @param waitStage first stage reading the results, the previous stages overlap the compute work
+ * @param fence
+ */
+inline void submit_after_compute(VkQueue graphicsQueue, VkCommandBuffer commandBuffer, VkSemaphore timelineSemaphore,
+                                 uint64_t waitValue, VkPipelineStageFlags waitStage, VkFence fence = VK_NULL_HANDLE)
+{
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .waitSemaphoreValueCount = 1,
+        .pWaitSemaphoreValues = &waitValue,
+    };
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timelineInfo,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &timelineSemaphore,
+        .pWaitDstStageMask = &waitStage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+    };
+
+    VkResult res = vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence);
+    if (res != VK_SUCCESS)
+        std::cerr << "Failed to submit command buffer : " << res << std::endl;
+}
+} // namespace Compute
 } // namespace RHI
\ No newline at end of file
@@ -0,0 +1,53 @@
+#version 450
+
+layout(location = 0) in vec2 fragUV;
+
+layout(location = 0) out vec4 oColor;
+
+// SPECIALIZED selects the feature toggles between the specialization constants and the uniform buffer
+layout(constant_id = 0) const bool SPECIALIZED = false;
+layout(constant_id = 1) const bool FEATURE_WAVES = false;
+layout(constant_id = 2) const bool FEATURE_RINGS = false;
+layout(constant_id = 3) const bool FEATURE_NOISE = false;
+layout(constant_id = 4) const bool FEATURE_VIGNETTE = false;
+
+layout(binding = 0) uniform Features
+{
+	uint mask;
+} features;
+
+bool is_enabled(uint index, bool specializedValue)
+{
+	return SPECIALIZED ? specializedValue : (features.mask & (1u << index)) != 0u;
+}
+
+float hash(vec2 p)
+{
+	return fract(sin(dot(p, vec2(12.9898, 78.233))) * 43758.5453);
+}
+
+void main()
+{
+	vec3 color = vec3(fragUV, 0.5);
+
+	if (is_enabled(0u, FEATURE_WAVES))
+	{
+		for (int i = 0; i < 16; ++i)
+			color.r += 0.05 * sin(fragUV.x * 40.0 + float(i)) * cos(fragUV.y * 40.0 - float(i));
+	}
+	if (is_enabled(1u, FEATURE_RINGS))
+	{
+		float d = length(fragUV - 0.5);
+		for (int i = 0; i < 16; ++i)
+			color.g += 0.05 * sin(d * 80.0 * float(i + 1));
+	}
+	if (is_enabled(2u, FEATURE_NOISE))
+	{
+		for (int i = 0; i < 16; ++i)
+			color.b += 0.02 * hash(fragUV * float(i + 1));
+	}
+	if (is_enabled(3u, FEATURE_VIGNETTE))
+		color *= smoothstep(0.8, 0.2, length(fragUV - 0.5));
+
+	oColor = vec4(color, 1.0);
+}
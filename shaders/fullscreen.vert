@@ -0,0 +1,10 @@
+#version 450
+
+layout(location = 0) out vec2 fragUV;
+
+void main()
+{
+	// triangle covering the whole viewport, no vertex buffer
+	fragUV = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	gl_Position = vec4(fragUV * 2.0 - 1.0, 0.0, 1.0);
+}
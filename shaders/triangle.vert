@@ -9,14 +9,20 @@ layout(location = 1) out vec2 fragUV;
 
 layout(binding = 0) uniform UniformBufferObject
 {
-	mat4 model;
 	mat4 view;
 	mat4 proj;
 } ubo;
 
+layout(push_constant) uniform Draw
+{
+	mat4 model;
+	uint materialID;
+	uint materialBuffer;
+} draw;
+
 void main()
 {
-	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(aPos, 1.0);
+	gl_Position = ubo.proj * ubo.view * draw.model * vec4(aPos, 1.0);
 	fragColor = aColor;
 	fragUV = aUV;
 }
\ No newline at end of file
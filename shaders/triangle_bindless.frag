@@ -0,0 +1,35 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec2 fragUV;
+
+layout(location = 0) out vec4 oColor;
+
+struct Material
+{
+	vec4 color;
+	uint textureIndex;
+	uint padding0;
+	uint padding1;
+	uint padding2;
+};
+
+// bindless table
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+layout(std430, set = 1, binding = 1) readonly buffer Materials
+{
+	Material materials[];
+} materialBuffers[];
+
+layout(push_constant) uniform Draw
+{
+	mat4 model;
+	uint materialID;
+	uint materialBuffer;
+} draw;
+
+void main()
+{
+	Material material = materialBuffers[draw.materialBuffer].materials[draw.materialID];
+	oColor = texture(textures[nonuniformEXT(material.textureIndex)], fragUV) * material.color;
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 450
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aColor;
+layout(location = 2) in vec2 aUV;
+
+layout(location = 0) out vec2 fragUV;
+
+layout(binding = 0) uniform UniformBufferObject
+{
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+// material of the draw in the bindless table
+layout(push_constant) uniform Draw
+{
+	mat4 model;
+	uint materialID;
+	uint materialBuffer;
+} draw;
+
+void main()
+{
+	gl_Position = ubo.proj * ubo.view * draw.model * vec4(aPos, 1.0);
+	fragUV = aUV;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#version 450
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aColor;
+layout(location = 2) in vec2 aUV;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV;
+
+layout(binding = 0) uniform UniformBufferObject
+{
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+struct ObjectData
+{
+	mat4 model;
+	vec4 boundingSphere;
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint padding;
+};
+
+// objects that passed the culling, indexed by the first instance of their indirect draw
+layout(std430, set = 1, binding = 0) readonly buffer Objects
+{
+	ObjectData objects[];
+};
+
+void main()
+{
+	gl_Position = ubo.proj * ubo.view * objects[gl_InstanceIndex].model * vec4(aPos, 1.0);
+	fragColor = aColor;
+	fragUV = aUV;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 450
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aColor;
+layout(location = 2) in vec2 aUV;
+
+// per instance
+layout(location = 3) in mat4 iModel;
+layout(location = 7) in vec4 iColor;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV;
+
+layout(binding = 0) uniform UniformBufferObject
+{
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+void main()
+{
+	gl_Position = ubo.proj * ubo.view * iModel * vec4(aPos, 1.0);
+	fragColor = iColor.rgb;
+	fragUV = aUV;
+}
\ No newline at end of file
@@ -3,22 +3,75 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include "bindless.hpp"
+#include "culling.hpp"
+#include "jobs.hpp"
+#include "mesh_optimizer.hpp"
+#include "pipeline_compiler.hpp"
+#include "profiler.hpp"
+#include "shader_compiler.hpp"
 #include "wsi.hpp"
 
 #include "uniform_desc.hpp"
 #include "vertex_desc.hpp"
 #include "vulkan_minimal.hpp"
 
-int main()
+int main(int argc, char **argv)
 {
     // TODO : better pipeline creation
 
-    WSI::init();
+    bool bParallelRecording = true;
+    // no window, surface nor swapchain : renders offscreen, e.g. on display-less nodes with a software driver
+    bool bHeadless = false;
+    // 0 renders until the window is closed
+    uint32_t frameLimit = 0;
+    // copy the rendered frames back to the host, headless only as the swapchain images belong to the presentation
+    bool bReadback = false;
+    // Chrome trace of the CPU and GPU scopes written on shutdown, empty to skip
+    std::string traceFilename;
+    // count the vertices, primitives and fragments of the draws, opt-in as the queries cost GPU time
+    bool bStatistics = false;
+    // copies of the mesh drawn with a single instanced draw
+    uint32_t instanceCount = 0;
+    // copies of the mesh culled against the frustum by a compute pass and drawn with indirect draws
+    uint32_t culledObjectCount = 0;
+    // materials drawn through the bindless table, each with its own texture
+    uint32_t bindlessMaterialCount = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--single-thread")
+            bParallelRecording = false;
+        else if (arg == "--headless")
+            bHeadless = true;
+        else if (arg == "--readback")
+            bReadback = true;
+        else if (arg == "--instances" && i + 1 < argc)
+            instanceCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (arg == "--gpu-culling" && i + 1 < argc)
+            culledObjectCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (arg == "--bindless" && i + 1 < argc)
+            bindlessMaterialCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (arg == "--statistics")
+            bStatistics = true;
+        else if (arg == "--trace" && i + 1 < argc)
+            traceFilename = argv[++i];
+        else if (arg == "--frames" && i + 1 < argc)
+            frameLimit = static_cast<uint32_t>(std::stoul(argv[++i]));
+    }
+    if (bHeadless && frameLimit == 0)
+        frameLimit = 300;
+    bReadback &= bHeadless;
 
     int width = 1366, height = 768;
 
-    GLFWwindow *window = WSI::create_window(width, height, "Vulkan Minimal");
-    WSI::make_context_current(window);
+    GLFWwindow *window = nullptr;
+    if (!bHeadless)
+    {
+        WSI::init();
+        window = WSI::create_window(width, height, "Vulkan Minimal");
+        WSI::make_context_current(window);
+    }
 
     RHI::load_symbols();
     std::vector<std::string> availableLayers = RHI::Instance::enumerate_available_layers();
@@ -31,7 +84,9 @@ int main()
     if (std::find(availableLayers.begin(), availableLayers.end(), "VK_LAYER_LUNARG_monitor") != availableLayers.end())
         layers.emplace_back("VK_LAYER_LUNARG_monitor");
 
-    std::vector<const char *> instanceExtensions = WSI::get_required_extensions();
+    std::vector<const char *> instanceExtensions;
+    if (!bHeadless)
+        instanceExtensions = WSI::get_required_extensions();
     instanceExtensions.push_back("VK_EXT_debug_utils");
     instanceExtensions.push_back("VK_EXT_debug_report");
     VkInstance instance = RHI::Instance::create_instance(layers, instanceExtensions, false);
@@ -45,25 +100,73 @@ int main()
     for (auto physicalDevice : physicalDevices)
         RHI::Device::enumerate_available_device_extensions(physicalDevice);
 
-    VkSurfaceKHR surface =
-        RHI::Presentation::Surface::create_surface(&WSI::create_presentation_surface, instance, window, nullptr);
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    if (!bHeadless)
+    {
+        surface =
+            RHI::Presentation::Surface::create_surface(&WSI::create_presentation_surface, instance, window, nullptr);
+    }
 
     VkPhysicalDevice physicalDevice = physicalDevices[0];
     std::optional<uint32_t> graphicsFamilyIndex =
         RHI::Device::Queue::find_queue_family_index(physicalDevice, VK_QUEUE_GRAPHICS_BIT);
-    std::optional<uint32_t> presentFamilyIndex =
-        RHI::Device::Queue::find_present_queue_family_index(physicalDevice, surface);
-    const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-    VkDevice device = RHI::Device::create_logical_device(instance, physicalDevice, &surface, layers, deviceExtensions);
+    std::optional<uint32_t> presentFamilyIndex;
+    if (!bHeadless)
+        presentFamilyIndex = RHI::Device::Queue::find_present_queue_family_index(physicalDevice, surface);
+    // uploads go through the graphics queue if there is no dedicated transfer queue
+    uint32_t transferFamilyIndex =
+        RHI::Device::Queue::find_transfer_queue_family_index(physicalDevice).value_or(graphicsFamilyIndex.value());
+    std::vector<const char *> deviceExtensions;
+    if (!bHeadless)
+        deviceExtensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    // the culling runs on an async compute queue if there is one, overlapping the graphics work of the frame
+    std::optional<uint32_t> computeFamilyIndex;
+    if (culledObjectCount > 0)
+        computeFamilyIndex = RHI::Device::Queue::find_async_compute_queue_family_index(physicalDevice);
+    RHI::Device::EnabledFeatures enabledFeatures;
+    VkDevice device =
+        RHI::Device::create_logical_device(instance, physicalDevice, bHeadless ? nullptr : &surface, layers,
+                                           deviceExtensions, computeFamilyIndex.has_value(), &enabledFeatures);
     VkQueue graphicsQueue = RHI::Device::Queue::get_device_queue(device, graphicsFamilyIndex.value(), 0);
-    VkQueue presentQueue = RHI::Device::Queue::get_device_queue(device, presentFamilyIndex.value(), 0);
-
-    std::optional<VkSurfaceFormatKHR> surfaceFormat = RHI::Presentation::Surface::find_adequate_surface_format(
-        physicalDevice, surface, VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR);
-    VkSwapchainKHR swapchain =
-        RHI::Presentation::SwapChain::create_swap_chain(physicalDevice, device, surface, surfaceFormat.value(),
-                                                        static_cast<uint32_t>(width), static_cast<uint32_t>(height));
-    std::vector<VkImage> swapchainImages = RHI::Presentation::SwapChain::get_swap_chain_images(device, swapchain);
+    VkQueue presentQueue = VK_NULL_HANDLE;
+    if (!bHeadless)
+        presentQueue = RHI::Device::Queue::get_device_queue(device, presentFamilyIndex.value(), 0);
+    VkQueue transferQueue = RHI::Device::Queue::get_device_queue(device, transferFamilyIndex, 0);
+
+    // shared by every pipeline creation, written back on shutdown for faster warm startups
+    const std::string pipelineCacheFilename = "pipeline_cache.bin";
+    VkPipelineCache pipelineCache = RHI::Pipeline::create_pipeline_cache(device, physicalDevice, pipelineCacheFilename);
+
+    RHI::Memory::Allocator allocator = RHI::Memory::create_allocator(device, physicalDevice);
+
+    // in headless mode, the back buffers are offscreen images left ready to be copied after the render pass
+    std::optional<VkSurfaceFormatKHR> surfaceFormat =
+        VkSurfaceFormatKHR{VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    std::vector<VkImage> swapchainImages;
+    std::vector<RHI::Memory::Allocation> offscreenAllocations;
+    VkImageLayout backBufferFinalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    if (bHeadless)
+    {
+        backBufferFinalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        for (int i = 0; i < 2; ++i)
+        {
+            auto offscreenImage = RHI::Memory::Image::create_allocated_image(
+                device, allocator, width, height,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, surfaceFormat->format);
+            swapchainImages.emplace_back(offscreenImage.first);
+            offscreenAllocations.emplace_back(offscreenImage.second);
+        }
+    }
+    else
+    {
+        surfaceFormat = RHI::Presentation::Surface::find_adequate_surface_format(
+            physicalDevice, surface, VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR);
+        swapchain = RHI::Presentation::SwapChain::create_swap_chain(physicalDevice, device, surface,
+                                                                    surfaceFormat.value(), static_cast<uint32_t>(width),
+                                                                    static_cast<uint32_t>(height));
+        swapchainImages = RHI::Presentation::SwapChain::get_swap_chain_images(device, swapchain);
+    }
     std::vector<VkImageView> swapchainImageViews(swapchainImages.size());
     for (int i = 0; i < swapchainImageViews.size(); ++i)
     {
@@ -73,31 +176,85 @@ int main()
     uint32_t frameInFlightCount = static_cast<uint32_t>(swapchainImages.size());
     VkFormat depthImageFormat = VK_FORMAT_D32_SFLOAT_S8_UINT;
     auto swapchainDepthImage = RHI::Memory::Image::create_allocated_image(
-        device, physicalDevice, width, height, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthImageFormat,
+        device, allocator, width, height, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthImageFormat,
         VK_IMAGE_TILING_OPTIMAL, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     VkImageView swapchainDepthImageView = RHI::Memory::Image::create_image_view(
         device, swapchainDepthImage.first, depthImageFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
-    VkRenderPass renderPass = RHI::RenderPass::create_render_pass(device, surfaceFormat->format, depthImageFormat);
+    VkRenderPass renderPass =
+        RHI::RenderPass::create_render_pass(device, surfaceFormat->format, depthImageFormat, backBufferFinalLayout);
 
     VkExtent2D extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
     std::vector<VkFramebuffer> framebuffers =
         RHI::RenderPass::create_framebuffers(device, renderPass, swapchainImageViews, swapchainDepthImageView, extent);
 
     std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
-        UniformDesc::get_uniform_descriptor_set_layout_bindings();
+        UniformDesc::get_uniform_descriptor_set_layout_bindings(true);
     std::vector<VkDescriptorSetLayout> setLayouts = {
         RHI::Pipeline::Shader::create_descriptor_set_layout(device, setLayoutBindings)};
-    VkPipelineLayout pipelineLayout = RHI::Pipeline::Shader::create_pipeline_layout(device, setLayouts);
-    VkPipeline pipeline = RHI::Pipeline::create_pipeline(device, renderPass, "triangle", extent, pipelineLayout);
+    // every layout declares the draw push constants, the per object data is pushed with the draws
+    VkPipelineLayout pipelineLayout = RHI::Pipeline::Shader::create_pipeline_layout(
+        device, setLayouts, UniformDesc::get_draw_push_constant_ranges());
+    VkPipelineLayout culledPipelineLayout = VK_NULL_HANDLE;
+
+    // the shader sources are compiled at startup (unchanged ones come from the SPIR-V cache) and on every change
+    std::unique_ptr<ShaderCompiler::Service> shaderCompiler =
+        ShaderCompiler::create_service(SHADER_SOURCE_DIR, "shaders", "shader_cache");
+    std::unique_ptr<RHI::Pipeline::Shader::ModuleCache> shaderModuleCache =
+        RHI::Pipeline::Shader::create_module_cache(device);
+    // pipelines compile in the background, their draws are skipped until they are ready as there is no fallback
+    std::unique_ptr<RHI::Pipeline::Compiler::Compiler> pipelineCompiler =
+        RHI::Pipeline::Compiler::create_compiler(device, pipelineCache, shaderModuleCache.get());
+    RHI::Pipeline::Compiler::PipelineHandle pipelineHandle = RHI::Pipeline::Compiler::request_pipeline(
+        *pipelineCompiler, RHI::Pipeline::get_default_pipeline_desc(renderPass, "triangle", pipelineLayout));
+    RHI::Pipeline::Compiler::PipelineHandle instancedPipelineHandle = RHI::Pipeline::Compiler::request_pipeline(
+        *pipelineCompiler,
+        RHI::Pipeline::get_instanced_pipeline_desc(renderPass, "triangle_instanced", pipelineLayout));
+    RHI::Pipeline::Compiler::PipelineHandle culledPipelineHandle;
 
     VkCommandPool commandPool = RHI::Command::create_command_pool(device, graphicsFamilyIndex.value());
-    VkCommandPool commandPoolTransient = RHI::Command::create_command_pool(device, graphicsFamilyIndex.value(), true);
+    RHI::Memory::Staging::Ring stagingRing = RHI::Memory::Staging::create_staging_ring(
+        device, allocator, graphicsQueue, graphicsFamilyIndex.value(), transferQueue, transferFamilyIndex);
+
+    // frames are handed to the consumer a few frames after their submission, the rendering never waits for them
+    uint64_t readbackFrameCount = 0;
+    uint64_t readbackByteCount = 0;
+    std::optional<RHI::Memory::Readback::Ring> readbackRing;
+    if (bReadback)
+    {
+        readbackRing = RHI::Memory::Readback::create_readback_ring(
+            device, allocator, graphicsFamilyIndex.value(), extent.width, extent.height, 4, 3,
+            [&](uint64_t frameNumber, const void *data, VkDeviceSize size, uint32_t width, uint32_t height) {
+                ++readbackFrameCount;
+                readbackByteCount += size;
+            });
+    }
 
     uint32_t bufferingType = 2;
     std::vector<VkCommandBuffer> commandBuffers =
         RHI::Command::allocate_command_buffers(device, commandPool, bufferingType);
 
+    std::unique_ptr<Profiler::Session> profiler =
+        Profiler::create_session(device, physicalDevice, graphicsFamilyIndex.value(), bufferingType);
+    std::unique_ptr<Profiler::StatisticsSession> statistics;
+    if (bStatistics)
+        statistics = Profiler::create_statistics_session(device, physicalDevice, bufferingType);
+
+    // every thread records its draws in its own pool, one set of pools per frame in flight so that a pool is only
+    // reset once the fence of its frame is signaled
+    std::unique_ptr<Jobs::Scheduler> scheduler =
+        bParallelRecording ? Jobs::create_scheduler() : Jobs::create_scheduler(0);
+    uint32_t recordingThreadCount = Jobs::get_thread_count(*scheduler);
+    std::vector<std::vector<RHI::Command::SecondaryCommandPool>> secondaryCommandPools(bufferingType);
+    for (int i = 0; i < bufferingType; ++i)
+    {
+        for (uint32_t j = 0; j < recordingThreadCount; ++j)
+        {
+            secondaryCommandPools[i].emplace_back(
+                RHI::Command::create_secondary_command_pool(device, graphicsFamilyIndex.value()));
+        }
+    }
+
     std::vector<VkSemaphore> acquireSemaphores;
     std::vector<VkSemaphore> renderSemaphores;
     std::vector<VkFence> inFlightFences;
@@ -108,125 +265,517 @@ int main()
         inFlightFences.emplace_back(RHI::Parallel::create_fence(device));
     }
 
+    // mesh
+
+    std::vector<Vertex> vertices = {{{-0.5f, -0.5f, 0.f}, {1.f, 0.f, 0.f, 1.f}, {1.f, 0.f}},
+                                    {{0.5f, -0.5f, 0.f}, {0.f, 1.f, 0.f, 1.f}, {0.f, 0.f}},
+                                    {{0.5f, 0.5f, 0.f}, {0.f, 0.f, 1.f, 1.f}, {0.f, 1.f}},
+                                    {{-0.5f, 0.5f, 0.f}, {1.f, 1.f, 1.f, 1.f}, {1.f, 1.f}},
+                                    {{-0.5f, -0.5f, -0.5f}, {1.f, 0.f, 0.f, 1.f}, {1.f, 0.f}},
+                                    {{0.5f, -0.5f, -0.5f}, {0.f, 1.f, 0.f, 1.f}, {0.f, 0.f}},
+                                    {{0.5f, 0.5f, -0.5f}, {0.f, 0.f, 1.f, 1.f}, {0.f, 1.f}},
+                                    {{-0.5f, 0.5f, -0.5f}, {1.f, 1.f, 1.f, 1.f}, {1.f, 1.f}}};
+    std::vector<uint16_t> indices = {0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4};
+
+    // load time mesh processing, deterministic so that its output could be cached with the mesh
+    MeshOptimizer::print_report(MeshOptimizer::optimize_mesh(vertices, indices));
+
     // vertex buffer
 
-    const std::vector<Vertex> vertices = {{{-0.5f, -0.5f, 0.f}, {1.f, 0.f, 0.f, 1.f}, {1.f, 0.f}},
-                                          {{0.5f, -0.5f, 0.f}, {0.f, 1.f, 0.f, 1.f}, {0.f, 0.f}},
-                                          {{0.5f, 0.5f, 0.f}, {0.f, 0.f, 1.f, 1.f}, {0.f, 1.f}},
-                                          {{-0.5f, 0.5f, 0.f}, {1.f, 1.f, 1.f, 1.f}, {1.f, 1.f}},
-                                          {{-0.5f, -0.5f, -0.5f}, {1.f, 0.f, 0.f, 1.f}, {1.f, 0.f}},
-                                          {{0.5f, -0.5f, -0.5f}, {0.f, 1.f, 0.f, 1.f}, {0.f, 0.f}},
-                                          {{0.5f, 0.5f, -0.5f}, {0.f, 0.f, 1.f, 1.f}, {0.f, 1.f}},
-                                          {{-0.5f, 0.5f, -0.5f}, {1.f, 1.f, 1.f, 1.f}, {1.f, 1.f}}};
     size_t vertexBufferSize = sizeof(Vertex) * vertices.size();
     auto vertexBuffer = RHI::Memory::Buffer::create_optimal_buffer_from_data(
-        device, physicalDevice, vertexBufferSize, vertices.data(), commandPoolTransient, graphicsQueue,
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        device, allocator, stagingRing, vertexBufferSize, vertices.data(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 
     // index buffer
 
-    const std::vector<uint16_t> indices = {0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4};
     size_t indexBufferSize = sizeof(uint16_t) * indices.size();
     auto indexBuffer = RHI::Memory::Buffer::create_optimal_buffer_from_data(
-        device, physicalDevice, indexBufferSize, indices.data(), commandPoolTransient, graphicsQueue,
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        device, allocator, stagingRing, indexBufferSize, indices.data(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
-    // uniform buffers
+    // culled objects, a wide grid of the mesh around the camera so that most of it is out of the frustum
 
-    std::vector<std::pair<VkBuffer, VkDeviceMemory>> uniformBuffers(frameInFlightCount);
-    std::vector<void *> uniformBuffersMapped(frameInFlightCount);
-    size_t uniformBufferSize = sizeof(UniformBufferObjectT);
-    for (int i = 0; i < frameInFlightCount; ++i)
+    // the culled draws are counted and instanced by the device
+    bool bGpuCullingSupported = enabledFeatures.features12.drawIndirectCount &&
+                                enabledFeatures.features.multiDrawIndirect &&
+                                enabledFeatures.features.drawIndirectFirstInstance;
+    if (culledObjectCount > 0 && !bGpuCullingSupported)
     {
-        uniformBuffers[i] = RHI::Memory::Buffer::create_allocated_buffer(
-            device, physicalDevice, uniformBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        vkMapMemory(device, uniformBuffers[i].second, 0, uniformBufferSize, 0, &uniformBuffersMapped[i]);
+        std::cerr << "Failed to enable GPU culling : indirect count draws are not supported" << std::endl;
+        culledObjectCount = 0;
     }
+    std::unique_ptr<Culling::Culler> culler;
+    if (culledObjectCount > 0)
+    {
+        std::vector<uint32_t> objectFamilyIndices;
+        if (computeFamilyIndex.has_value())
+        {
+            std::set<uint32_t> families = {graphicsFamilyIndex.value(), computeFamilyIndex.value(),
+                                           transferFamilyIndex};
+            objectFamilyIndices.assign(families.begin(), families.end());
+        }
+        culler = Culling::create_culler(device, allocator, bufferingType, culledObjectCount, "shaders/cull.comp.spv",
+                                        pipelineCache, shaderModuleCache.get(), objectFamilyIndices);
+    }
+    VkQueue computeQueue = VK_NULL_HANDLE;
+    VkCommandPool computeCommandPool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> computeCommandBuffers;
+    // signaled with the frame number + 1 once the frame is culled
+    VkSemaphore cullSemaphore = VK_NULL_HANDLE;
+    if (culler && computeFamilyIndex.has_value())
+    {
+        computeQueue = RHI::Device::Queue::get_device_queue(device, computeFamilyIndex.value(), 0);
+        computeCommandPool = RHI::Command::create_command_pool(device, computeFamilyIndex.value());
+        computeCommandBuffers = RHI::Command::allocate_command_buffers(device, computeCommandPool, bufferingType);
+        cullSemaphore = RHI::Parallel::create_timeline_semaphore(device);
+    }
+    if (culler)
+    {
+        std::vector<Culling::ObjectData> objects(culledObjectCount);
+        uint32_t gridSide = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(culledObjectCount))));
+        for (uint32_t i = 0; i < culledObjectCount; ++i)
+        {
+            glm::vec3 position = glm::vec3(static_cast<float>(i % gridSide) - gridSide * 0.5f, -1.f,
+                                           static_cast<float>(i / gridSide) - gridSide * 0.5f) *
+                                 2.f;
+            objects[i] = Culling::ObjectData{
+                .model = glm::translate(glm::mat4(1.f), position),
+                // bounds of the two quads of the mesh
+                .boundingSphere = glm::vec4(0.f, 0.f, -0.25f, 0.75f),
+                .indexCount = static_cast<uint32_t>(indices.size()),
+                .firstIndex = 0,
+                .vertexOffset = 0,
+            };
+        }
+        Culling::upload_objects(*culler, stagingRing, objects);
+
+        culledPipelineLayout =
+            RHI::Pipeline::Shader::create_pipeline_layout(device, {setLayouts[0], culler->drawSetLayout},
+                                                          UniformDesc::get_draw_push_constant_ranges());
+        RHI::Pipeline::PipelineDesc culledPipelineDesc =
+            RHI::Pipeline::get_default_pipeline_desc(renderPass, "triangle", culledPipelineLayout);
+        culledPipelineDesc.shaderStages[0].path = "shaders/triangle_culled.vert.spv";
+        culledPipelineHandle = RHI::Pipeline::Compiler::request_pipeline(*pipelineCompiler, culledPipelineDesc);
+    }
+
+    // instance buffer, a square crowd of the mesh
+
+    std::vector<Instance> instances(instanceCount);
+    uint32_t crowdSide = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(instanceCount))));
+    for (uint32_t i = 0; i < instanceCount; ++i)
+    {
+        glm::vec2 cell = {static_cast<float>(i % crowdSide), static_cast<float>(i / crowdSide)};
+        glm::vec3 position = glm::vec3(cell.x - crowdSide * 0.5f, 0.f, -cell.y) * 1.5f;
+        instances[i] = Instance{
+            .model = glm::translate(glm::mat4(1.f), position),
+            .color = glm::vec4(cell.x / crowdSide, cell.y / crowdSide, 1.f - cell.x / crowdSide, 1.f),
+        };
+    }
+    std::pair<VkBuffer, RHI::Memory::Allocation> instanceBuffer = {VK_NULL_HANDLE, {}};
+    if (instanceCount > 0)
+    {
+        instanceBuffer = RHI::Memory::Buffer::create_optimal_buffer_from_data(
+            device, allocator, stagingRing, sizeof(Instance) * instances.size(), instances.data(),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    }
+
+    // uniform buffers, a region of the arena per frame in flight, the uniforms of a frame are selected by dynamic
+    // offset so a single descriptor set is bound for every frame and object
 
-    std::vector<VkDescriptorPoolSize> poolSizes = UniformDesc::get_uniform_descriptor_pool_sizes(frameInFlightCount);
-    VkDescriptorPool descriptorPool =
-        RHI::Pipeline::Shader::create_descriptor_pool(device, poolSizes, frameInFlightCount);
-    std::vector<VkDescriptorSetLayout> uniformSetLayouts(frameInFlightCount, setLayouts[0]);
-    std::vector<VkDescriptorSet> descriptorSets =
-        RHI::Pipeline::Shader::allocate_desriptor_sets(device, descriptorPool, frameInFlightCount, uniformSetLayouts);
+    RHI::Memory::Uniform::Arena uniformArena =
+        RHI::Memory::Uniform::create_uniform_arena(device, allocator, physicalDevice, bufferingType);
+
+    std::vector<VkDescriptorPoolSize> poolSizes = UniformDesc::get_uniform_descriptor_pool_sizes(1, true);
+    VkDescriptorPool descriptorPool = RHI::Pipeline::Shader::create_descriptor_pool(device, poolSizes, 1);
+    VkDescriptorSet descriptorSet =
+        RHI::Pipeline::Shader::allocate_desriptor_sets(device, descriptorPool, 1, {setLayouts[0]})[0];
 
     const std::vector<unsigned char> imagePixels = {255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 255, 255, 255, 0, 255, 255};
-    auto texture = RHI::Memory::Image::create_image_texture_from_data(
-        device, physicalDevice, 2, 2, imagePixels.data(), commandPoolTransient, graphicsQueue, VK_FORMAT_R8G8B8A8_SRGB);
+    auto texture = RHI::Memory::Image::create_image_texture_from_data(device, allocator, stagingRing, 2, 2,
+                                                                      imagePixels.data(), VK_FORMAT_R8G8B8A8_SRGB);
+    VkSampler sampler = RHI::Memory::Image::create_image_sampler(device, VK_FILTER_NEAREST);
+
+    // bindless materials, a texture per material registered in the table with the material buffer, the draws only
+    // push the slots of their resources
+    std::unique_ptr<Bindless::Table> bindlessTable;
+    if (bindlessMaterialCount > 0)
+        bindlessTable = Bindless::create_table(device, physicalDevice);
+    std::vector<std::pair<VkImage, RHI::Memory::Allocation>> bindlessTextures;
+    std::vector<VkImageView> bindlessTextureViews;
+    std::pair<VkBuffer, RHI::Memory::Allocation> materialBuffer = {VK_NULL_HANDLE, {}};
+    uint32_t materialBufferSlot = Bindless::invalidSlot;
+    VkPipelineLayout bindlessPipelineLayout = VK_NULL_HANDLE;
+    RHI::Pipeline::Compiler::PipelineHandle bindlessPipelineHandle;
+    if (bindlessTable)
+    {
+        std::vector<MaterialT> materials(bindlessMaterialCount);
+        for (uint32_t i = 0; i < bindlessMaterialCount; ++i)
+        {
+            unsigned char shade = static_cast<unsigned char>(255 * (i + 1) / bindlessMaterialCount);
+            const std::vector<unsigned char> pixels = {shade, 0, 255, 255, 255, shade, 0, 255,
+                                                       0,     255, shade, 255, shade, shade, shade, 255};
+            bindlessTextures.emplace_back(RHI::Memory::Image::create_image_texture_from_data(
+                device, allocator, stagingRing, 2, 2, pixels.data(), VK_FORMAT_R8G8B8A8_SRGB));
+            bindlessTextureViews.emplace_back(RHI::Memory::Image::create_image_view(
+                device, bindlessTextures[i].first, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT));
+            materials[i] = MaterialT{
+                .color = glm::vec4(1.f),
+                .textureIndex = Bindless::register_texture(*bindlessTable, bindlessTextureViews[i], sampler),
+            };
+        }
+        materialBuffer = RHI::Memory::Buffer::create_optimal_buffer_from_data(
+            device, allocator, stagingRing, sizeof(MaterialT) * materials.size(), materials.data(),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        materialBufferSlot = Bindless::register_buffer(*bindlessTable, materialBuffer.first);
+
+        bindlessPipelineLayout = RHI::Pipeline::Shader::create_pipeline_layout(
+            device, {setLayouts[0], bindlessTable->setLayout}, UniformDesc::get_draw_push_constant_ranges());
+        bindlessPipelineHandle = RHI::Pipeline::Compiler::request_pipeline(
+            *pipelineCompiler,
+            RHI::Pipeline::get_default_pipeline_desc(renderPass, "triangle_bindless", bindlessPipelineLayout));
+    }
+
+    // every upload above is submitted at once, the ownership acquire is queued on the graphics queue before the first
+    // frame so the frame loop never waits for the uploads on the host. The culling queue is not ordered after that
+    // acquire, its submissions wait for the upload value on the device, the objects being shared by both families
+    uint64_t uploadValue = RHI::Memory::Staging::flush(stagingRing);
     VkImageView textureView = RHI::Memory::Image::create_image_view(device, texture.first, VK_FORMAT_R8G8B8A8_SRGB,
                                                                     VK_IMAGE_ASPECT_COLOR_BIT);
-    VkSampler sampler = RHI::Memory::Image::create_image_sampler(device, VK_FILTER_NEAREST);
 
-    for (int i = 0; i < frameInFlightCount; ++i)
     {
-        VkDescriptorBufferInfo bufferInfo = {
-            .buffer = uniformBuffers[i].first,
-            .offset = 0,
-            .range = sizeof(UniformBufferObjectT),
-        };
+        VkDescriptorBufferInfo bufferInfo =
+            RHI::Memory::Uniform::get_descriptor_buffer_info(uniformArena, sizeof(UniformBufferObjectT));
         VkDescriptorImageInfo imageInfo = {
             .sampler = sampler,
             .imageView = textureView,
             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
         };
         std::vector<VkWriteDescriptorSet> writes =
-            UniformDesc::get_uniform_descriptor_set_writes(descriptorSets[i], bufferInfo, imageInfo);
+            UniformDesc::get_uniform_descriptor_set_writes(descriptorSet, bufferInfo, imageInfo, true);
         RHI::Pipeline::Shader::write_descriptor_sets(device, writes);
     }
 
-    uint32_t backBufferIndex = 0;
-    while (!WSI::should_close(window))
+    RHI::Memory::print_statistics(allocator);
+
+    struct DrawItem
+    {
+        VkBuffer vertexBuffer;
+        VkBuffer indexBuffer;
+        uint32_t indexCount;
+        DrawConstantsT constants;
+    };
+    const std::vector<DrawItem> drawItems = {
+        {vertexBuffer.first, indexBuffer.first, static_cast<uint32_t>(indices.size()), {.model = glm::mat4(1.f)}},
+    };
+    const uint32_t drawsPerJob = 64;
+    std::vector<VkCommandBuffer> secondaryCommandBuffers;
+
+    // pipelines rebuilt on hot reload, each with its rebuilt pipeline waiting for its compilation to be swapped in
+    std::vector<std::pair<RHI::Pipeline::Compiler::PipelineHandle *, RHI::Pipeline::Compiler::PipelineHandle>>
+        reloadablePipelines;
+    for (RHI::Pipeline::Compiler::PipelineHandle *handle :
+         {&pipelineHandle, &instancedPipelineHandle, &culledPipelineHandle, &bindlessPipelineHandle})
     {
-        WSI::poll_events();
+        if (*handle)
+            reloadablePipelines.emplace_back(handle, nullptr);
+    }
 
-        uint32_t imageIndex = RHI::Render::acquire_back_buffer(device, swapchain, acquireSemaphores[backBufferIndex],
-                                                               inFlightFences[backBufferIndex]);
+    uint32_t backBufferIndex = 0;
+    for (uint32_t frameIndex = 0; frameLimit == 0 || frameIndex < frameLimit; ++frameIndex)
+    {
+        Profiler::begin_frame(*profiler);
+
+        if (!bHeadless)
+        {
+            if (WSI::should_close(window))
+                break;
+            WSI::poll_events();
+        }
+
+        // hot reload, the previous pipeline keeps being used until the rebuilt one is ready
+        for (const std::string &shaderPath : ShaderCompiler::take_reloaded_paths(*shaderCompiler))
+        {
+            RHI::Pipeline::Shader::invalidate_shader_path(*shaderModuleCache, shaderPath);
+            if (RHI::Pipeline::Compiler::invalidate_pipelines(*pipelineCompiler, shaderPath, frameIndex) > 0)
+            {
+                for (auto &[handle, reloadingHandle] : reloadablePipelines)
+                    reloadingHandle = RHI::Pipeline::Compiler::request_pipeline(*pipelineCompiler, (*handle)->desc);
+            }
+        }
+        for (auto &[handle, reloadingHandle] : reloadablePipelines)
+        {
+            if (reloadingHandle && RHI::Pipeline::Compiler::is_pipeline_ready(reloadingHandle))
+            {
+                const RHI::Pipeline::CreationStats &stats = reloadingHandle->stats;
+                std::cout << "Pipeline rebuilt in " << stats.hostMs << " ms";
+                if (stats.bDriverFeedback)
+                    std::cout << " (driver " << stats.driverMs << " ms, cache " << (stats.bCacheHit ? "hit" : "miss")
+                              << ")";
+                std::cout << std::endl;
+                *handle = reloadingHandle;
+                reloadingHandle.reset();
+            }
+        }
+
+        // recycle the staging space of the completed uploads without blocking
+        RHI::Memory::Staging::retire_batches(stagingRing);
+
+        Profiler::CpuScope acquireScope = Profiler::begin_cpu_scope("acquire");
+        uint32_t imageIndex =
+            bHeadless ? RHI::Render::acquire_offscreen_back_buffer(device, frameIndex, frameInFlightCount,
+                                                                   inFlightFences[backBufferIndex])
+                      : RHI::Render::acquire_back_buffer(device, swapchain, acquireSemaphores[backBufferIndex],
+                                                         inFlightFences[backBufferIndex]);
+        Profiler::end_cpu_scope(*profiler, acquireScope);
+
+        // the fence of this frame has been waited on, the pipelines replaced before the previous frames can go
+        RHI::Pipeline::Compiler::collect_retired_pipelines(*pipelineCompiler, frameIndex, bufferingType);
 
         UniformBufferObjectT ubo = {
-            .model = glm::mat4(1.f),
             .view = glm::lookAt(glm::vec3(0.f, 1.f, 1.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f)),
             .proj = glm::perspective(glm::radians(45.f), extent.width / (float)extent.height, 0.1f, 1000.f),
         };
-        memcpy(uniformBuffersMapped[imageIndex], &ubo, sizeof(ubo));
-
-        RHI::Render::record_back_buffer_begin_render_pass(commandBuffers[backBufferIndex], renderPass,
-                                                          framebuffers[imageIndex], extent, pipeline);
-        RHI::Render::record_back_buffer_descriptor_sets_commands(commandBuffers[backBufferIndex], pipelineLayout,
-                                                                 descriptorSets[imageIndex]);
-        RHI::Render::record_back_buffer_draw_indexed_object_commands(
-            commandBuffers[backBufferIndex], vertexBuffer.first, indexBuffer.first, indices.size());
-        RHI::Render::record_back_buffer_end_render_pass(commandBuffers[backBufferIndex]);
+        // the fence of this frame has been waited on, its uniforms can be overwritten
+        RHI::Memory::Uniform::begin_frame(uniformArena, backBufferIndex);
+        std::optional<uint32_t> uboOffset = RHI::Memory::Uniform::push(uniformArena, ubo);
+        // the draws reading the uniforms are skipped rather than reading those of another frame
+        if (!uboOffset.has_value())
+            std::cerr << "Failed to push the frame uniforms : uniform arena full" << std::endl;
+
+        // the fence of this frame has been waited on, its secondary command buffers can be recycled
+        for (RHI::Command::SecondaryCommandPool &pool : secondaryCommandPools[backBufferIndex])
+            RHI::Command::reset_secondary_command_pool(device, pool);
+
+        Profiler::CpuScope recordScope = Profiler::begin_cpu_scope("record");
+        // the queries are reset outside of the render pass, whose contents are only secondary command buffers, and
+        // before the secondary command buffers using them are recorded
+        VkCommandBuffer commandBuffer = commandBuffers[backBufferIndex];
+        RHI::Render::record_back_buffer_begin(commandBuffer);
+        Profiler::begin_gpu_frame(*profiler, commandBuffer, backBufferIndex);
+        if (statistics)
+            Profiler::begin_statistics_frame(*statistics, commandBuffer, backBufferIndex);
+        if (culler && computeQueue != VK_NULL_HANDLE)
+        {
+            // the compute command buffer of this frame completed before its fence
+            VkCommandBuffer computeCommandBuffer = computeCommandBuffers[backBufferIndex];
+            RHI::Render::record_back_buffer_begin(computeCommandBuffer);
+            Culling::record_cull(*culler, computeCommandBuffer, backBufferIndex, ubo.proj * ubo.view,
+                                 computeFamilyIndex.value(), graphicsFamilyIndex.value());
+            RHI::Render::record_back_buffer_end(computeCommandBuffer);
+            RHI::Compute::submit_compute(computeQueue, computeCommandBuffer, cullSemaphore, frameIndex + 1, 0,
+                                         VK_NULL_HANDLE, stagingRing.uploadSemaphore, uploadValue);
+            Culling::record_acquire_culled_draws(*culler, commandBuffer, backBufferIndex, computeFamilyIndex.value(),
+                                                 graphicsFamilyIndex.value());
+        }
+        else if (culler)
+        {
+            uint32_t cullScope = Profiler::begin_gpu_scope(*profiler, commandBuffer, "cull");
+            Culling::record_cull(*culler, commandBuffer, backBufferIndex, ubo.proj * ubo.view);
+            Profiler::end_gpu_scope(*profiler, commandBuffer, cullScope);
+        }
+
+        // each job records a range of the draw list in a secondary command buffer of the thread running it
+        VkPipeline pipeline = RHI::Pipeline::Compiler::get_pipeline(*pipelineCompiler, pipelineHandle);
+        uint32_t drawCount =
+            pipeline != VK_NULL_HANDLE && uboOffset.has_value() ? static_cast<uint32_t>(drawItems.size()) : 0;
+        secondaryCommandBuffers.resize((drawCount + drawsPerJob - 1) / drawsPerJob);
+        Jobs::parallel_for(*scheduler, drawCount, drawsPerJob, [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+            Profiler::CpuScope jobScope = Profiler::begin_cpu_scope("record draws");
+            VkCommandBuffer secondaryCommandBuffer = RHI::Command::get_secondary_command_buffer(
+                device, secondaryCommandPools[backBufferIndex][threadIndex]);
+            RHI::Render::record_secondary_begin_render_pass(secondaryCommandBuffer, renderPass, 0,
+                                                            framebuffers[imageIndex], extent, pipeline);
+            RHI::Render::record_back_buffer_descriptor_sets_commands(secondaryCommandBuffer, pipelineLayout,
+                                                                     descriptorSet, {uboOffset.value()});
+            uint32_t statisticsQuery =
+                statistics ? Profiler::begin_pass_statistics(*statistics, secondaryCommandBuffer, "opaque") : ~0u;
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                RHI::Render::record_back_buffer_draw_indexed_object_commands(
+                    secondaryCommandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                    drawItems[i].constants, drawItems[i].vertexBuffer, drawItems[i].indexBuffer,
+                    drawItems[i].indexCount);
+            }
+            if (statistics)
+                Profiler::end_pass_statistics(*statistics, secondaryCommandBuffer, statisticsQuery);
+            RHI::Render::record_secondary_end(secondaryCommandBuffer);
+            secondaryCommandBuffers[begin / drawsPerJob] = secondaryCommandBuffer;
+            Profiler::end_cpu_scope(*profiler, jobScope);
+        });
+
+        // the whole crowd is a single draw
+        VkPipeline instancedPipeline =
+            RHI::Pipeline::Compiler::get_pipeline(*pipelineCompiler, instancedPipelineHandle);
+        if (instanceCount > 0 && instancedPipeline != VK_NULL_HANDLE && uboOffset.has_value())
+        {
+            VkCommandBuffer crowdCommandBuffer =
+                RHI::Command::get_secondary_command_buffer(device, secondaryCommandPools[backBufferIndex][0]);
+            RHI::Render::record_secondary_begin_render_pass(crowdCommandBuffer, renderPass, 0,
+                                                            framebuffers[imageIndex], extent, instancedPipeline);
+            RHI::Render::record_back_buffer_descriptor_sets_commands(crowdCommandBuffer, pipelineLayout,
+                                                                     descriptorSet, {uboOffset.value()});
+            RHI::Render::record_back_buffer_draw_indexed_instanced_commands(
+                crowdCommandBuffer, vertexBuffer.first, instanceBuffer.first, indexBuffer.first,
+                static_cast<uint32_t>(indices.size()), instanceCount);
+            RHI::Render::record_secondary_end(crowdCommandBuffer);
+            secondaryCommandBuffers.emplace_back(crowdCommandBuffer);
+        }
+
+        // the draw count is only known by the device
+        VkPipeline culledPipeline =
+            culler ? RHI::Pipeline::Compiler::get_pipeline(*pipelineCompiler, culledPipelineHandle) : VK_NULL_HANDLE;
+        if (culledPipeline != VK_NULL_HANDLE && uboOffset.has_value())
+        {
+            VkCommandBuffer culledCommandBuffer =
+                RHI::Command::get_secondary_command_buffer(device, secondaryCommandPools[backBufferIndex][0]);
+            RHI::Render::record_secondary_begin_render_pass(culledCommandBuffer, renderPass, 0,
+                                                            framebuffers[imageIndex], extent, culledPipeline);
+            RHI::Render::record_back_buffer_descriptor_sets_commands(culledCommandBuffer, culledPipelineLayout,
+                                                                     descriptorSet, {uboOffset.value()});
+            uint32_t statisticsQuery =
+                statistics ? Profiler::begin_pass_statistics(*statistics, culledCommandBuffer, "culled") : ~0u;
+            Culling::record_culled_draws(*culler, culledCommandBuffer, backBufferIndex, culledPipelineLayout, 1,
+                                         vertexBuffer.first, indexBuffer.first);
+            if (statistics)
+                Profiler::end_pass_statistics(*statistics, culledCommandBuffer, statisticsQuery);
+            RHI::Render::record_secondary_end(culledCommandBuffer);
+            secondaryCommandBuffers.emplace_back(culledCommandBuffer);
+        }
+
+        // the table is bound once, the draws only push the slots of their material
+        VkPipeline bindlessPipeline =
+            bindlessTable ? RHI::Pipeline::Compiler::get_pipeline(*pipelineCompiler, bindlessPipelineHandle)
+                          : VK_NULL_HANDLE;
+        if (bindlessPipeline != VK_NULL_HANDLE && uboOffset.has_value())
+        {
+            VkCommandBuffer bindlessCommandBuffer =
+                RHI::Command::get_secondary_command_buffer(device, secondaryCommandPools[backBufferIndex][0]);
+            RHI::Render::record_secondary_begin_render_pass(bindlessCommandBuffer, renderPass, 0,
+                                                            framebuffers[imageIndex], extent, bindlessPipeline);
+            RHI::Render::record_back_buffer_descriptor_sets_commands(bindlessCommandBuffer, bindlessPipelineLayout,
+                                                                     descriptorSet, {uboOffset.value()});
+            Bindless::record_bind_table(*bindlessTable, bindlessCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        bindlessPipelineLayout, 1);
+            // one quad per material, side by side
+            for (uint32_t i = 0; i < bindlessMaterialCount; ++i)
+            {
+                DrawConstantsT constants = {
+                    .model = glm::translate(glm::mat4(1.f), glm::vec3(1.25f * i, 0.f, 0.f)),
+                    .materialID = i,
+                    .materialBuffer = materialBufferSlot,
+                };
+                RHI::Render::record_back_buffer_draw_indexed_object_commands(
+                    bindlessCommandBuffer, bindlessPipelineLayout,
+                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, constants, vertexBuffer.first,
+                    indexBuffer.first, static_cast<uint32_t>(indices.size()));
+            }
+            RHI::Render::record_secondary_end(bindlessCommandBuffer);
+            secondaryCommandBuffers.emplace_back(bindlessCommandBuffer);
+        }
+
+        uint32_t renderPassScope = Profiler::begin_gpu_scope(*profiler, commandBuffer, "render pass");
+        RHI::Render::record_begin_render_pass(commandBuffer, renderPass, framebuffers[imageIndex], extent, pipeline,
+                                              VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        RHI::Render::record_back_buffer_execute_commands(commandBuffer, secondaryCommandBuffers);
+        RHI::Render::record_end_render_pass(commandBuffer);
+        Profiler::end_gpu_scope(*profiler, commandBuffer, renderPassScope);
+        RHI::Render::record_back_buffer_end(commandBuffer);
+        Profiler::end_cpu_scope(*profiler, recordScope);
+
+        Profiler::CpuScope submitScope = Profiler::begin_cpu_scope("submit");
+        if (bHeadless)
+        {
+            VkFence &inFlightFence = inFlightFences[backBufferIndex];
+            if (cullSemaphore != VK_NULL_HANDLE)
+            {
+                RHI::Compute::submit_after_compute(graphicsQueue, commandBuffer, cullSemaphore, frameIndex + 1,
+                                                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, inFlightFence);
+            }
+            else
+            {
+                RHI::Render::submit_offscreen_back_buffer(graphicsQueue, commandBuffer, inFlightFence);
+            }
+            Profiler::end_cpu_scope(*profiler, submitScope);
+            if (readbackRing.has_value())
+            {
+                RHI::Memory::Readback::read_back_image(*readbackRing, graphicsQueue, swapchainImages[imageIndex],
+                                                       frameIndex);
+            }
+        }
+        else
+        {
+            RHI::Render::submit_back_buffer(graphicsQueue, commandBuffer, acquireSemaphores[backBufferIndex],
+                                            renderSemaphores[backBufferIndex], inFlightFences[backBufferIndex],
+                                            cullSemaphore, frameIndex + 1);
+            Profiler::end_cpu_scope(*profiler, submitScope);
+
+            Profiler::CpuScope presentScope = Profiler::begin_cpu_scope("present");
+            RHI::Render::present_back_buffer(presentQueue, swapchain, imageIndex, renderSemaphores[backBufferIndex]);
+            Profiler::end_cpu_scope(*profiler, presentScope);
+
+            WSI::swap_buffers(window);
+        }
+        backBufferIndex = (backBufferIndex + 1) % bufferingType;
+    }
 
-        RHI::Render::submit_back_buffer(graphicsQueue, commandBuffers[backBufferIndex],
-                                        acquireSemaphores[backBufferIndex], renderSemaphores[backBufferIndex],
-                                        inFlightFences[backBufferIndex]);
+    vkDeviceWaitIdle(device);
 
-        RHI::Render::present_back_buffer(presentQueue, swapchain, imageIndex, renderSemaphores[backBufferIndex]);
+    Profiler::print_stats(*profiler);
+    if (!traceFilename.empty())
+        Profiler::export_chrome_trace(*profiler, traceFilename);
+    Profiler::destroy_session(profiler);
+    if (statistics)
+    {
+        Profiler::print_statistics_report(*statistics, static_cast<uint64_t>(extent.width) * extent.height);
+        Profiler::destroy_statistics_session(statistics);
+    }
 
-        WSI::swap_buffers(window);
-        backBufferIndex = (backBufferIndex + 1) % bufferingType;
+    if (readbackRing.has_value())
+    {
+        RHI::Memory::Readback::destroy_readback_ring(*readbackRing);
+        std::cout << "Read back " << readbackFrameCount << " frames (" << readbackByteCount << " bytes), "
+                  << readbackRing->droppedCount << " dropped" << std::endl;
     }
 
-    vkDeviceWaitIdle(device);
+    if (bindlessTable)
+    {
+        Bindless::destroy_table(bindlessTable);
+        RHI::Memory::free_memory(allocator, materialBuffer.second);
+        RHI::Memory::Buffer::destroy_buffer(device, materialBuffer.first);
+        for (uint32_t i = 0; i < bindlessMaterialCount; ++i)
+        {
+            RHI::Memory::Image::destroy_image_view(device, bindlessTextureViews[i]);
+            RHI::Memory::free_memory(allocator, bindlessTextures[i].second);
+            RHI::Memory::Image::destroy_image(device, bindlessTextures[i].first);
+        }
+    }
 
     RHI::Memory::Image::destroy_image_sampler(device, sampler);
     RHI::Memory::Image::destroy_image_view(device, textureView);
-    RHI::Memory::free_memory(device, texture.second);
+    RHI::Memory::free_memory(allocator, texture.second);
     RHI::Memory::Image::destroy_image(device, texture.first);
 
     RHI::Pipeline::Shader::destroy_descriptor_pool(device, descriptorPool);
 
-    for (int i = 0; i < frameInFlightCount; ++i)
+    RHI::Memory::Uniform::destroy_uniform_arena(uniformArena);
+
+    if (culler)
+        Culling::destroy_culler(culler);
+    if (computeCommandPool != VK_NULL_HANDLE)
     {
-        RHI::Memory::free_memory(device, uniformBuffers[i].second);
-        RHI::Memory::Buffer::destroy_buffer(device, uniformBuffers[i].first);
+        RHI::Command::destroy_command_pool(device, computeCommandPool);
+        RHI::Parallel::destroy_semaphore(device, cullSemaphore);
     }
 
-    RHI::Memory::free_memory(device, indexBuffer.second);
+    if (instanceCount > 0)
+    {
+        RHI::Memory::free_memory(allocator, instanceBuffer.second);
+        RHI::Memory::Buffer::destroy_buffer(device, instanceBuffer.first);
+    }
+
+    RHI::Memory::free_memory(allocator, indexBuffer.second);
     RHI::Memory::Buffer::destroy_buffer(device, indexBuffer.first);
 
-    RHI::Memory::free_memory(device, vertexBuffer.second);
+    RHI::Memory::free_memory(allocator, vertexBuffer.second);
     RHI::Memory::Buffer::destroy_buffer(device, vertexBuffer.first);
 
     for (int i = 0; i < bufferingType; ++i)
@@ -239,11 +788,27 @@ int main()
     renderSemaphores.clear();
     acquireSemaphores.clear();
 
-    RHI::Command::destroy_command_pool(device, commandPoolTransient);
+    for (int i = 0; i < bufferingType; ++i)
+    {
+        for (RHI::Command::SecondaryCommandPool &pool : secondaryCommandPools[i])
+            RHI::Command::destroy_secondary_command_pool(device, pool);
+    }
+    secondaryCommandPools.clear();
+    Jobs::destroy_scheduler(scheduler);
+
+    RHI::Memory::Staging::destroy_staging_ring(stagingRing);
     RHI::Command::destroy_command_pool(device, commandPool);
 
-    RHI::Pipeline::destroy_pipeline(device, pipeline);
+    RHI::Pipeline::Compiler::destroy_compiler(pipelineCompiler);
+    RHI::Pipeline::Shader::destroy_module_cache(shaderModuleCache);
+    ShaderCompiler::destroy_service(shaderCompiler);
+    RHI::Pipeline::save_pipeline_cache(device, pipelineCache, pipelineCacheFilename);
+    RHI::Pipeline::destroy_pipeline_cache(device, pipelineCache);
     RHI::Pipeline::Shader::destroy_pipeline_layout(device, pipelineLayout);
+    if (culledPipelineLayout != VK_NULL_HANDLE)
+        RHI::Pipeline::Shader::destroy_pipeline_layout(device, culledPipelineLayout);
+    if (bindlessPipelineLayout != VK_NULL_HANDLE)
+        RHI::Pipeline::Shader::destroy_pipeline_layout(device, bindlessPipelineLayout);
     for (VkDescriptorSetLayout setLayout : setLayouts)
     {
         RHI::Pipeline::Shader::destroy_descriptor_set_layout(device, setLayout);
@@ -254,27 +819,44 @@ int main()
     RHI::RenderPass::destroy_render_pass(device, renderPass);
 
     RHI::Memory::Image::destroy_image_view(device, swapchainDepthImageView);
-    RHI::Memory::free_memory(device, swapchainDepthImage.second);
+    RHI::Memory::free_memory(allocator, swapchainDepthImage.second);
     RHI::Memory::Image::destroy_image(device, swapchainDepthImage.first);
 
     for (int i = 0; i < swapchainImageViews.size(); ++i)
     {
         RHI::Memory::Image::destroy_image_view(device, swapchainImageViews[i]);
     }
-    RHI::Presentation::SwapChain::destroy_swap_chain(device, swapchain);
+    if (bHeadless)
+    {
+        for (int i = 0; i < swapchainImages.size(); ++i)
+        {
+            RHI::Memory::free_memory(allocator, offscreenAllocations[i]);
+            RHI::Memory::Image::destroy_image(device, swapchainImages[i]);
+        }
+    }
+    else
+    {
+        RHI::Presentation::SwapChain::destroy_swap_chain(device, swapchain);
+    }
+
+    RHI::Memory::destroy_allocator(allocator);
 
     RHI::Device::destroy_logical_device(device);
 
-    RHI::Presentation::Surface::destroy_surface(instance, surface);
+    if (!bHeadless)
+        RHI::Presentation::Surface::destroy_surface(instance, surface);
 
     RHI::Instance::Debug::destroy_debug_report_callback(instance, debugReport);
     RHI::Instance::Debug::destroy_debug_messenger(instance, debugMessenger);
 
     RHI::Instance::destroy_instance(instance);
 
-    WSI::destroy_window(window);
+    if (!bHeadless)
+    {
+        WSI::destroy_window(window);
 
-    WSI::terminate();
+        WSI::terminate();
+    }
 
     return EXIT_SUCCESS;
 }
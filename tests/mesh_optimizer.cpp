@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+#include "mesh_optimizer.hpp"
+
+// The reordering steps must keep every triangle of the mesh, whatever the cache state of its first triangle.
+
+using Triangle = std::array<glm::vec3, 3>;
+
+static std::vector<Vertex> make_grid(uint32_t size)
+{
+    std::vector<Vertex> vertices;
+    for (uint32_t y = 0; y <= size; ++y)
+    {
+        for (uint32_t x = 0; x <= size; ++x)
+            vertices.emplace_back(Vertex{.position = {float(x), float(y), 0.f}, .color = {1.f, 1.f, 1.f, 1.f}});
+    }
+    return vertices;
+}
+
+/**
+ * @brief triangles as sorted positions, independent of the vertex order and of the first vertex of each triangle
+ *
+ */
+static std::vector<Triangle> get_triangles(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices)
+{
+    std::vector<Triangle> triangles;
+    auto less = [](const glm::vec3 &a, const glm::vec3 &b) {
+        return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+    };
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        Triangle triangle = {vertices[indices[i]].position, vertices[indices[i + 1]].position,
+                             vertices[indices[i + 2]].position};
+        std::sort(triangle.begin(), triangle.end(), less);
+        triangles.emplace_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end(), [&less](const Triangle &a, const Triangle &b) {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+    });
+    return triangles;
+}
+
+static bool check(bool bCondition, const char *message)
+{
+    if (!bCondition)
+        std::cerr << "Failed : " << message << std::endl;
+    return bCondition;
+}
+
+int main()
+{
+    const uint32_t size = 8;
+    std::vector<Vertex> vertices = make_grid(size);
+
+    // a degenerate first triangle misses the cache on two vertices only
+    std::vector<uint32_t> indices = {0, 0, 1};
+    for (uint32_t y = 0; y < size; ++y)
+    {
+        for (uint32_t x = 0; x < size; ++x)
+        {
+            uint32_t i = y * (size + 1) + x;
+            indices.insert(indices.end(), {i, i + size + 1, i + 1, i + 1, i + size + 1, i + size + 2});
+        }
+    }
+    const std::vector<Triangle> expected = get_triangles(vertices, indices);
+
+    bool bPassed = true;
+
+    std::vector<uint32_t> overdrawIndices = indices;
+    MeshOptimizer::optimize_overdraw(overdrawIndices, vertices);
+    bPassed &= check(overdrawIndices.size() == indices.size(), "optimize_overdraw changed the triangle count");
+    bPassed &= check(get_triangles(vertices, overdrawIndices) == expected, "optimize_overdraw changed the triangles");
+
+    std::vector<Vertex> optimizedVertices = vertices;
+    std::vector<uint32_t> optimizedIndices = indices;
+    MeshOptimizer::optimize_mesh(optimizedVertices, optimizedIndices);
+    bPassed &= check(optimizedIndices.size() == indices.size(), "optimize_mesh changed the triangle count");
+    bPassed &= check(get_triangles(optimizedVertices, optimizedIndices) == expected,
+                     "optimize_mesh changed the triangles");
+
+    return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}